@@ -0,0 +1,65 @@
+#pragma once
+
+#include "nanocc/ir/ModRef.h"
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace nanocc {
+
+class Instruction;
+class Value;
+
+enum class AliasResult {
+  NoAlias,   ///< the two pointers never refer to the same word
+  MayAlias,  ///< nothing is known
+  MustAlias, ///< the two pointers always refer to the same word
+};
+
+/// A pointer split into the object it points into and a word offset:
+/// `base + sum(index * scale) + offset`.
+struct PointerDecomposition {
+  /// Local `alloc`, GlobalVariable, pointer Argument, or any other value
+  /// the walk could not see through
+  Value *base = nullptr;
+  std::vector<std::pair<Value *, int64_t>> varIndices;
+  int64_t offset = 0;
+};
+
+/// Alias analysis over the memory-form IR.
+///
+/// Pointers are traced back through `getelemptr`/`getptr` chains to their
+/// underlying object. Array parameters live in a stack slot that is stored
+/// once in the entry block; loads from such a slot are resolved to the
+/// incoming Argument. Distinct locals and globals never alias, and a local
+/// whose address never escapes cannot be reached through an argument or a
+/// call. Calls are described by the MemoryEffects of the callee, see
+/// FunctionAttrsPass.
+class AliasAnalysis {
+public:
+  AliasResult alias(Value *A, Value *B);
+
+  /// Effect of a load, store or call \p I on the word at \p Ptr
+  ModRefInfo getModRefInfo(Instruction *I, Value *Ptr);
+
+  /// Effect of a call on memory in general, ignoring non-escaping locals
+  MemoryEffects getMemoryEffects(Instruction *Call);
+
+  PointerDecomposition decompose(Value *Ptr);
+
+  /// Underlying object of \p Ptr, see PointerDecomposition::base
+  Value *getUnderlyingObject(Value *Ptr) { return decompose(Ptr).base; }
+
+  /// `alloc` whose address is never passed to a call, stored to memory or
+  /// otherwise leaked; only direct loads and stores can touch it
+  bool isNonEscapingLocal(Value *V);
+
+private:
+  std::unordered_map<const Value *, bool> escapeCache_;
+
+  /// The underlying objects may overlap at some offset
+  bool mayShareObject(Value *BaseA, Value *BaseB);
+};
+
+} // namespace nanocc
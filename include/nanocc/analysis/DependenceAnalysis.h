@@ -0,0 +1,74 @@
+#pragma once
+
+#include "nanocc/analysis/AliasAnalysis.h"
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <unordered_set>
+#include <vector>
+
+namespace nanocc {
+
+class Instruction;
+class Loop;
+class Value;
+
+/// `constant + sum(coefficient * term)`. A term is an induction variable
+/// slot (a load of it reads the current iteration's value) or a value that
+/// is the same throughout the loop nest.
+struct AffineExpr {
+  std::map<Value *, int64_t> terms;
+  int64_t constant = 0;
+};
+
+/// A load or store split into the accessed object and one subscript per
+/// array dimension, outermost first
+struct ArrayAccess {
+  Instruction *inst = nullptr;
+  Value *base = nullptr;
+  std::vector<AffineExpr> subscripts;
+  bool isWrite = false;
+  /// every subscript is an affine expression
+  bool affine = true;
+};
+
+/// Subscript-wise dependence testing of array accesses in a loop nest.
+///
+/// Subscripts are read off the `getelemptr`/`getptr` chain of an address,
+/// one index per dimension, and are assumed to stay within their dimension
+/// as C requires. Two accesses to the same object can only touch the same
+/// word if every subscript agrees, which yields one equation per dimension
+/// over the iteration distance of each induction variable.
+class DependenceAnalysis {
+public:
+  /// \p L is the outermost loop of the nest, \p IVSlots the stack slots of
+  /// its induction variables
+  DependenceAnalysis(Loop *L, const std::vector<Value *> &IVSlots,
+                     AliasAnalysis &AA);
+
+  std::optional<AffineExpr> getAffine(Value *V);
+  ArrayAccess getAccess(Instruction *I);
+
+  enum class Result {
+    Independent, ///< the accesses never touch the same word
+    Dependent,   ///< see the distance vector
+    Unknown,     ///< nothing could be proven
+  };
+
+  /// Iteration distance (iteration of \p B minus iteration of \p A) per
+  /// induction variable, in the order given to the constructor. A
+  /// std::nullopt entry means any distance is possible.
+  Result getDistance(const ArrayAccess &A, const ArrayAccess &B,
+                     std::vector<std::optional<int64_t>> &Distance);
+
+private:
+  Loop *L_;
+  std::vector<Value *> ivSlots_;
+  AliasAnalysis &AA_;
+  std::unordered_set<Value *> storedSlots_;
+
+  /// Slot that a load of \p V reads unchanged throughout the nest
+  Value *getInvariantSlot(Value *V);
+};
+
+} // namespace nanocc
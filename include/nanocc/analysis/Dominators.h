@@ -0,0 +1,34 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+namespace nanocc {
+
+class BasicBlock;
+class Function;
+
+/// Dominator tree of the blocks reachable from the entry, computed with the
+/// iterative algorithm of Cooper, Harvey and Kennedy.
+class DominatorTree {
+public:
+  explicit DominatorTree(Function &F);
+
+  /// Reachable blocks in reverse postorder, entry first
+  const std::vector<BasicBlock *> &getReversePostOrder() const { return rpo_; }
+
+  /// Immediate dominator, nullptr for the entry and unreachable blocks
+  BasicBlock *getIDom(BasicBlock *BB) const;
+
+  /// Every path from the entry to \p B goes through \p A
+  bool dominates(BasicBlock *A, BasicBlock *B) const;
+
+  bool isReachable(BasicBlock *BB) const { return rpoIndex_.count(BB); }
+
+private:
+  std::vector<BasicBlock *> rpo_;
+  std::unordered_map<BasicBlock *, unsigned> rpoIndex_;
+  std::vector<unsigned> idom_; ///< indexed by RPO number
+};
+
+} // namespace nanocc
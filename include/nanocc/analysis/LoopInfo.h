@@ -0,0 +1,82 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace nanocc {
+
+class BasicBlock;
+class DominatorTree;
+class Function;
+class Value;
+
+/// A natural loop: a header plus every block that reaches one of its back
+/// edges without passing through the header.
+class Loop {
+public:
+  BasicBlock *getHeader() const { return blocks_.front(); }
+  Loop *getParentLoop() const { return parent_; }
+  const std::vector<Loop *> &getSubLoops() const { return subLoops_; }
+
+  /// Blocks of the loop (including nested loops), header first
+  const std::vector<BasicBlock *> &getBlocks() const { return blocks_; }
+
+  bool contains(const BasicBlock *BB) const { return blockSet_.count(BB); }
+  bool contains(const Loop *L) const;
+
+  /// 1 for outermost loops
+  unsigned getLoopDepth() const;
+
+  /// In-loop predecessors of the header
+  std::vector<BasicBlock *> getLatches() const;
+  /// The single latch, or nullptr
+  BasicBlock *getLoopLatch() const;
+
+  /// Single out-of-loop predecessor of the header whose only successor is
+  /// the header, or nullptr
+  BasicBlock *getLoopPreheader() const;
+
+  /// Loop blocks with a successor outside the loop
+  std::vector<BasicBlock *> getExitingBlocks() const;
+  /// Out-of-loop blocks targeted from inside the loop, without duplicates
+  std::vector<BasicBlock *> getExitBlocks() const;
+  /// The single exit block, or nullptr
+  BasicBlock *getExitBlock() const;
+
+  /// \p V is not computed by an instruction inside the loop
+  bool isLoopInvariant(Value *V) const;
+
+private:
+  friend class LoopInfo;
+
+  std::vector<BasicBlock *> blocks_;
+  std::unordered_set<const BasicBlock *> blockSet_;
+  Loop *parent_ = nullptr;
+  std::vector<Loop *> subLoops_;
+};
+
+/// Loop nest of a function, built from the back edges of the dominator tree.
+/// @note the analysis is a snapshot; recompute it after changing the CFG
+class LoopInfo {
+public:
+  LoopInfo(Function &F, const DominatorTree &DT);
+
+  const std::vector<Loop *> &getTopLevelLoops() const { return topLevel_; }
+
+  /// Innermost loop containing \p BB, or nullptr
+  Loop *getLoopFor(const BasicBlock *BB) const;
+
+  /// Every loop, inner loops before the loops containing them
+  std::vector<Loop *> getLoopsInPostorder() const;
+
+  bool empty() const { return loops_.empty(); }
+
+private:
+  std::vector<std::unique_ptr<Loop>> loops_;
+  std::vector<Loop *> topLevel_;
+  std::unordered_map<const BasicBlock *, Loop *> innermost_;
+};
+
+} // namespace nanocc
@@ -2,6 +2,12 @@
 
 #include "FrameInfo.h"
 #include "koopa.h"
+#include <string>
+#include <unordered_set>
+
+namespace nanocc {
+class Module;
+} // namespace nanocc
 
 class ProgramCodeGen {
 public:
@@ -11,17 +17,27 @@ public:
   void Emit(const koopa_raw_program_t &program);
   static size_t CalcTypeSize(koopa_raw_type_t ty);
 
+  /// 记下 module 中从不被写入的全局变量, 它们放入 .rodata 段
+  void SetReadOnlyGlobals(const nanocc::Module &module);
+
+  /// 目标支持 Zicond 扩展时, select 用 czero.eqz/czero.nez 实现
+  void SetZicond(bool enable) { zicond_ = enable; }
+
 private:
   void EmitDataSection(const koopa_raw_slice_t &values);
   void EmitGlobalAlloc(const koopa_raw_value_t &value);
   void EmitInitializer(const koopa_raw_value_t &init);
 
   void EmitTextSection();
+
+  /// 只读全局变量的名字, 不带 @ 前缀
+  std::unordered_set<std::string> read_only_globals_;
+  bool zicond_ = false;
 };
 
 class FunctionCodeGen {
 public:
-  FunctionCodeGen() = default;
+  explicit FunctionCodeGen(bool zicond = false) : zicond_(zicond) {}
   ~FunctionCodeGen() = default;
 
   void EmitFunction(const koopa_raw_function_t &func);
@@ -32,6 +48,9 @@ private:
   void EmitSlice(const koopa_raw_slice_t &slice);
   void EmitBasicBlock(const koopa_raw_basic_block_t &bb);
   void EmitValue(const koopa_raw_value_t &value);
+  void EmitDivRemByConst(bool is_rem, int32_t divisor);
+  void EmitSelect(koopa_raw_value_t cond, koopa_raw_value_t true_val,
+                  koopa_raw_value_t false_val);
 
   void AllocateStackSpace();
 
@@ -45,4 +64,7 @@ private:
 
   koopa_raw_function_t func_;
   FrameInfo stack_frame_;
+  /// 布局上紧跟当前基本块的基本块, 跳到它时可以直接顺序执行
+  koopa_raw_basic_block_t next_bb_ = nullptr;
+  bool zicond_;
 };
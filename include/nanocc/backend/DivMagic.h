@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Magic multiplier and shift for signed division by a constant
+/// (Hacker's Delight, 10-4). For a divisor d with |d| not a power of two:
+///   q = mulh(n, multiplier)
+///   q += n  if d > 0 && multiplier < 0
+///   q -= n  if d < 0 && multiplier > 0
+///   q >>= shift (arithmetic)
+///   q += (uint32_t)q >> 31
+struct SignedDivMagic {
+  int32_t multiplier;
+  int shift;
+};
+
+/// @note requires |d| >= 2; powers of two are better served by shifts
+SignedDivMagic ComputeSignedDivMagic(int32_t d);
+
+/// One RV32IM instruction of a division or modulo by a constant
+struct DivRemInst {
+  enum Opcode { Li, Mv, Add, Sub, And, Mul, Mulh, Srai, Srli };
+  /// The registers the sequence uses
+  enum Reg { Zero, T0, T1, T2 };
+
+  Opcode op;
+  Reg rd;
+  Reg rs1 = Zero;
+  Reg rs2 = Zero;
+  /// Value of li, amount of srai/srli
+  int32_t imm = 0;
+};
+
+/// Instructions computing `t0 / divisor` (or `t0 % divisor` if \p is_rem)
+/// into t0 with C semantics, clobbering t1 and t2
+/// @note requires divisor != 0
+std::vector<DivRemInst> ExpandDivRemByConst(bool is_rem, int32_t divisor);
+
+/// Assembly text of \p inst, e.g. `srai t1, t1, 2`
+std::string FormatDivRemInst(const DivRemInst &inst);
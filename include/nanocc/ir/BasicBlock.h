@@ -6,6 +6,7 @@
 #include <list>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace nanocc {
 
@@ -25,6 +26,25 @@ public:
   InstListType &getInstList() { return instList_; }
   const InstListType &getInstList() const { return instList_; }
 
+  /// Returns the terminator instruction if the block is well formed
+  /// or nullptr if the block does not end with br/jump/ret.
+  Instruction *getTerminator() {
+    if (instList_.empty() || !instList_.back()->isTerminator())
+      return nullptr;
+    return instList_.back().get();
+  }
+
+  /// Blocks targeted by the terminator, without duplicates.
+  std::vector<BasicBlock *> getSuccessors();
+
+  /// Blocks whose terminator targets this block, without duplicates.
+  /// @note only terminators use basic blocks, so this walks the use list
+  std::vector<BasicBlock *> getPredecessors();
+
+  /// Unlink this block from its function and delete it.
+  /// @note the block must not be targeted by any remaining terminator
+  void eraseFromParent();
+
   static BasicBlock *create(Function &parent, const std::string &name = "");
 
   static bool classof(const Value *V) {
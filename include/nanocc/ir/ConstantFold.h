@@ -0,0 +1,16 @@
+#pragma once
+
+#include "nanocc/ir/Instruction.h"
+
+namespace nanocc {
+
+class ConstantInt;
+
+/// Fold a binary operation on two integer constants.
+/// Arithmetic wraps around like the target (two's complement, 32 bit);
+/// division and modulo by zero fold to 0.
+/// @return the folded constant, or nullptr if \p op is not foldable
+ConstantInt *ConstantFoldBinaryOp(Instruction::Opcode op, const ConstantInt *L,
+                                  const ConstantInt *R);
+
+} // namespace nanocc
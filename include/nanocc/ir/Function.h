@@ -2,6 +2,7 @@
 
 #include "nanocc/ir/BasicBlock.h"
 #include "nanocc/ir/GlobalValue.h"
+#include "nanocc/ir/ModRef.h"
 #include "nanocc/ir/Module.h"
 #include "nanocc/ir/Type.h"
 #include "nanocc/ir/Value.h"
@@ -24,6 +25,7 @@ public:
 
   Function *getParent() { return parent_; }
   unsigned getArgNo() const { return argNo_; }
+  void setArgNo(unsigned argNo) { argNo_ = argNo; }
   const std::string &getName() const { return name_; }
   void setName(const std::string &name) { name_ = name; }
 
@@ -67,8 +69,28 @@ public:
 
   std::string getName() const { return name_; }
 
+  LinkageTypes getLinkage() const { return linkage_; }
+
+  /// Declarations (library functions) have no body
+  bool isDeclaration() const { return basicBlockList_.empty(); }
+
   const std::vector<Argument *> &getArgs() const { return arguments_; }
 
+  /// Delete the unused argument \p ArgNo; later arguments are renumbered
+  /// and the parameter is removed from the function type.
+  /// @note call sites have to be rewritten by the caller
+  void eraseArgument(unsigned ArgNo);
+
+  /// Change the return type in the function type.
+  /// @note `ret` instructions and call sites have to be rewritten by the
+  /// caller
+  void setReturnType(Type *RetTy);
+
+  /// What a call may do to the caller's memory. Library declarations are
+  /// summarized by hand, defined functions by FunctionAttrsPass.
+  const MemoryEffects &getMemoryEffects() const { return memEffects_; }
+  void setMemoryEffects(const MemoryEffects &ME) { memEffects_ = ME; }
+
   void addBasicBlock(BasicBlock *bb) { basicBlockList_.push_back(bb); }
 
   std::string getUniqueName(const std::string &name);
@@ -83,6 +105,7 @@ private:
   LinkageTypes linkage_;
   std::list<BasicBlock *> basicBlockList_;
   std::vector<Argument *> arguments_;
+  MemoryEffects memEffects_;
 };
 
 } // namespace nanocc
@@ -45,6 +45,9 @@ public:
   /// Check if the global variable is constant
   bool isConstant() const { return isConstantGlobal_; }
 
+  /// Mark the global variable as never written
+  void setConstant(bool isConstant) { isConstantGlobal_ = isConstant; }
+
 private:
   std::string name_;                ///< Name of the global variable
   Constant *initializer_ = nullptr; ///< Initializer constant
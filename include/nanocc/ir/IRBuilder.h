@@ -3,6 +3,7 @@
 #include "nanocc/ir/BasicBlock.h"
 #include "nanocc/ir/Instruction.h"
 #include "nanocc/ir/Value.h"
+#include <cassert>
 #include <memory>
 #include <utility>
 
@@ -10,20 +11,29 @@ namespace nanocc {
 
 class IRBuilder {
 private:
-  BasicBlock *BB_;
+  BasicBlock *BB_ = nullptr;
+  BasicBlock::InstListType::iterator insertPt_;
 
 public:
   IRBuilder() = default;
   ~IRBuilder() = default;
 
-  void setInsertPoint(BasicBlock *BB) { BB_ = BB; }
+  /// Append new instructions to the end of \p BB
+  void setInsertPoint(BasicBlock *BB) {
+    BB_ = BB;
+    insertPt_ = BB->getInstList().end();
+  }
+
+  /// Insert new instructions right before \p I
+  void setInsertPoint(Instruction *I);
+
   BasicBlock *getInsertBlock() const { return BB_; }
 
   /// Insert instruction into current basic block
   Instruction *insert(std::unique_ptr<Instruction> inst) {
-    if (BB_)
-      BB_->getInstList().push_back(std::move(inst));
-    return BB_->getInstList().back().get();
+    assert(BB_ && "BasicBlock is null when inserting instruction!");
+    inst->setParent(BB_);
+    return BB_->getInstList().insert(insertPt_, std::move(inst))->get();
   }
 
   //===--------------------------------------------------------------------===//
@@ -33,6 +43,10 @@ public:
   /// Create binary operation instruction
   Value *createBinaryOp(Instruction::Opcode op, Value *lhs, Value *rhs);
 
+  /// Create `select cond, true_val, false_val`: true_val if cond is
+  /// non-zero, false_val otherwise. Both values are always evaluated.
+  Value *createSelect(Value *cond, Value *true_val, Value *false_val);
+
   //===--------------------------------------------------------------------===//
   // Create instructions for Memory Operations
   //
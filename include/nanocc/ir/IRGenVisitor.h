@@ -101,6 +101,11 @@ private:
   Value *evalLogicalAnd(BinaryExpAST *ast, Value *lhsVal = nullptr);
   Value *evalLogicalOr(BinaryExpAST *ast, Value *lhsVal = nullptr);
 
+  /// Lower \p ast in condition context: branch to \p trueBB if it is
+  /// non-zero, to \p falseBB otherwise. `&&`, `||` and `!` become branch
+  /// chains instead of materialized 0/1 values.
+  void emitCondBr(BaseAST *ast, BasicBlock *trueBB, BasicBlock *falseBB);
+
   /// Register library functions into the module and symbol table
   void registerLibFunctions();
 
@@ -114,6 +119,10 @@ private:
   void initializeLocalArray(const InitVarAST *init, Value *baseAddr,
                             Type *type);
 
+  /// Store zero into \p count consecutive i32 starting at \p ptr with a
+  /// loop instead of one store per element
+  void emitZeroFill(Value *ptr, int count);
+
   Constant *evalConstant(const InitVarAST *init, Type *ty);
 };
 
@@ -26,6 +26,13 @@ public:
     // Logical
     And,
     Or,
+    Xor,
+    // Shift
+    Shl, // shift left
+    Shr, // logical shift right
+    Sar, // arithmetic shift right
+    // Selection
+    Select, // cond ? true value : false value
     // Memory
     Alloc,            // allocate local variable
     GlobalAlloc,      // allocate global variable
@@ -56,6 +63,26 @@ public:
 
   Opcode getOpcode() const { return op_; }
 
+  /// Arithmetic, comparison, logical and shift operations
+  bool isBinaryOp() const { return op_ >= Opcode::Add && op_ <= Opcode::Sar; }
+
+  /// Comparisons always produce 0 or 1
+  bool isComparison() const { return op_ >= Opcode::Lt && op_ <= Opcode::Ne; }
+
+  bool isCommutative() const {
+    return op_ == Opcode::Add || op_ == Opcode::Mul || op_ == Opcode::Eq ||
+           op_ == Opcode::Ne || op_ == Opcode::And || op_ == Opcode::Or ||
+           op_ == Opcode::Xor;
+  }
+
+  bool isTerminator() const {
+    return op_ == Opcode::Br || op_ == Opcode::Jmp || op_ == Opcode::Ret;
+  }
+
+  /// Unlink this instruction from its basic block and delete it.
+  /// @note the instruction must not have any remaining uses
+  void eraseFromParent();
+
   static std::unique_ptr<Instruction> create(Type *ty, Opcode op,
                                              unsigned numOperands,
                                              BasicBlock *parent = nullptr) {
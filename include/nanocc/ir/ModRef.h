@@ -0,0 +1,55 @@
+#pragma once
+
+namespace nanocc {
+
+/// Bit set describing how an instruction may touch a memory location
+enum ModRefInfo : unsigned {
+  NoModRef = 0,
+  Ref = 1,
+  Mod = 2,
+  ModRef = Ref | Mod,
+};
+
+inline ModRefInfo operator|(ModRefInfo A, ModRefInfo B) {
+  return static_cast<ModRefInfo>(static_cast<unsigned>(A) |
+                                 static_cast<unsigned>(B));
+}
+
+inline ModRefInfo &operator|=(ModRefInfo &A, ModRefInfo B) { return A = A | B; }
+
+/// What a call to a function may do to memory visible to its caller.
+///
+/// Locals of the callee are invisible to the caller and not part of the
+/// summary. The default is the conservative "anything".
+struct MemoryEffects {
+  ModRefInfo globals = ModRef; ///< effect on global variables
+  ModRefInfo args = ModRef;    ///< effect on memory reachable from pointer args
+  bool io = true; ///< talks to the outside world (input, output, timers)
+
+  /// Touches neither globals nor memory behind its arguments
+  static MemoryEffects none() { return {NoModRef, NoModRef, false}; }
+
+  bool doesNotAccessMemory() const {
+    return globals == NoModRef && args == NoModRef;
+  }
+  bool onlyReadsMemory() const { return !((globals | args) & Mod); }
+
+  /// The result depends only on the argument values and the call has no
+  /// other observable effect
+  bool isPure() const { return doesNotAccessMemory() && !io; }
+
+  MemoryEffects &operator|=(const MemoryEffects &Other) {
+    globals |= Other.globals;
+    args |= Other.args;
+    io |= Other.io;
+    return *this;
+  }
+  bool operator==(const MemoryEffects &Other) const {
+    return globals == Other.globals && args == Other.args && io == Other.io;
+  }
+  bool operator!=(const MemoryEffects &Other) const {
+    return !(*this == Other);
+  }
+};
+
+} // namespace nanocc
@@ -43,9 +43,17 @@ public:
   Function *getOrInsertFunction(const std::string &name, Type *retTy,
                                 ArgsTy... args);
 
+  /// Unlink \p F from the module and delete it.
+  /// @note \p F must not be used anywhere
+  void eraseFunction(Function *F);
+
   GlobalVariable *getGlobalVariable(const std::string &name);
   GlobalVariable *getOrInsertGlobal(const std::string &name, Type *ty,
                                     bool isConstant);
+
+  /// Unlink \p GV from the module and delete it.
+  /// @note \p GV must not be used anywhere
+  void eraseGlobalVariable(GlobalVariable *GV);
 };
 
 } // namespace nanocc
\ No newline at end of file
@@ -0,0 +1,25 @@
+#pragma once
+
+namespace nanocc {
+
+class Function;
+class Module;
+
+/// Compiler support routines. Unlike the SysY library functions registered
+/// by IRGenVisitor::registerLibFunctions they are not provided by the
+/// runtime, so their bodies are emitted into the module on first use.
+namespace RuntimeLib {
+
+/// `void __nanocc_memset(*i32 dst, i32 val, i32 len)`
+constexpr const char *MemsetName = "__nanocc_memset";
+
+/// `void __nanocc_memcpy(*i32 dst, *i32 src, i32 len)`, copies ascending
+/// one word at a time, so overlapping ranges behave like the element-wise
+/// loop it replaces
+constexpr const char *MemcpyName = "__nanocc_memcpy";
+
+Function *getOrInsertMemset(Module &M);
+Function *getOrInsertMemcpy(Module &M);
+
+} // namespace RuntimeLib
+} // namespace nanocc
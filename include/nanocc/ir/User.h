@@ -25,6 +25,13 @@ public:
     operands_.push_back(U);
   }
 
+  /// Unlink every operand from its value's use list.
+  /// @note must be called before a User referenced by others is destroyed
+  void dropAllReferences() {
+    for (auto &U : operands_)
+      U->set(nullptr);
+  }
+
 protected:
   User(ValueID id, Type *ty) : Value(id, ty) {}
   std::vector<Use *> operands_;
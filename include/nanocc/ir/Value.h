@@ -2,6 +2,7 @@
 
 #include "nanocc/ir/Type.h"
 #include "nanocc/ir/Use.h"
+#include <cassert>
 
 namespace nanocc {
 
@@ -56,6 +57,15 @@ public:
   using use_iterator = Use *;
   use_iterator use_begin() { return useList_; }
   use_iterator use_end() { return nullptr; }
+
+  /// Return the number of uses of this value (walks the use list).
+  unsigned getNumUses() const;
+
+  /// Return true if there is exactly one use of this value.
+  bool hasOneUse() const;
+
+  /// Change all uses of this value to point to \p V instead.
+  void replaceAllUsesWith(Value *V);
 };
 
 inline void Use::set(Value *V) {
@@ -76,4 +86,21 @@ inline const Use &Use::operator=(const Use &RHS) {
   return *this;
 }
 
+inline unsigned Value::getNumUses() const {
+  unsigned n = 0;
+  for (Use *U = useList_; U; U = U->getNext())
+    ++n;
+  return n;
+}
+
+inline bool Value::hasOneUse() const {
+  return useList_ && !useList_->getNext();
+}
+
+inline void Value::replaceAllUsesWith(Value *V) {
+  assert(V != this && "Cannot replace a value with itself");
+  while (useList_)
+    useList_->set(V);
+}
+
 } // namespace nanocc
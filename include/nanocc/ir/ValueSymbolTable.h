@@ -26,6 +26,10 @@ public:
   /// Insert a symbol into the current scope
   bool insert(const std::string &name, Value *val);
 
+  /// Remove a symbol from the innermost scope that defines it
+  /// @return false if the symbol is not defined
+  bool erase(const std::string &name);
+
   /// Lookup a symbol by name
   /// @note Searches from the inner scope to the outer scope
   Value *lookup(const std::string &name) const;
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+namespace nanocc {
+
+class BasicBlock;
+class Function;
+class Instruction;
+class Module;
+class Value;
+
+/// Original value -> its copy
+using ValueMap = std::unordered_map<Value *, Value *>;
+
+/// Copy the instructions of \p BB into a new block named \p Name appended to
+/// \p F, recording every copy in \p VMap. Operands still refer to the
+/// original values until remapInstruction is applied.
+BasicBlock *cloneBasicBlock(BasicBlock *BB, Function &F,
+                            const std::string &Name, ValueMap &VMap);
+
+/// Replace each operand of \p I that has an entry in \p VMap
+void remapInstruction(Instruction *I, const ValueMap &VMap);
+
+/// Copy \p F into a new function \p Name placed right after it in \p M.
+/// Arguments, blocks and instructions are recorded in \p VMap.
+Function *cloneFunction(Function *F, const std::string &Name, Module &M,
+                        ValueMap &VMap);
+
+} // namespace nanocc
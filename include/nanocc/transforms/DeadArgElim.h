@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+
+namespace nanocc {
+
+class Function;
+class Instruction;
+class Module;
+
+/// Dead argument and return value elimination.
+///
+/// Only user functions whose every use is a direct call are changed (never
+/// `main`):
+/// - an argument every call site passes the same constant is replaced by
+///   that constant inside the function
+/// - an argument that is never read, or only handed unchanged to the same
+///   position of a recursive call, is removed
+/// - a return value no caller reads becomes `void`
+///
+/// Call sites are rebuilt to match the new signature.
+class DeadArgElimPass {
+public:
+  /// @return true if the module was modified
+  bool run(Module &M);
+
+private:
+  bool runOnFunction(Function &F, std::vector<Instruction *> &Calls);
+};
+
+} // namespace nanocc
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "nanocc/analysis/AliasAnalysis.h"
+#include <vector>
+
+namespace nanocc {
+
+class BasicBlock;
+class Function;
+class Instruction;
+
+/// Dead store elimination.
+///
+/// - stores into non-escaping locals that are never loaded from
+/// - stores into non-escaping scalar locals that are not live afterwards,
+///   found by a backward liveness dataflow over the CFG (this also covers
+///   stores that are dead at function exit)
+/// - stores overwritten later in the same block by a must-alias store with
+///   no possible read in between (zero padding of array initializers that
+///   the program immediately overwrites, repeated scalar assignments)
+class DeadStoreElimPass {
+public:
+  /// @return true if the function was modified
+  bool run(Function &F);
+
+private:
+  AliasAnalysis AA_;
+
+  bool removeUnreadLocals(Function &F);
+  bool removeDeadScalarStores(Function &F);
+  bool removeOverwrittenStores(BasicBlock *BB);
+};
+
+} // namespace nanocc
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "nanocc/analysis/AliasAnalysis.h"
+
+namespace nanocc {
+
+class Function;
+class Module;
+
+/// Bottom-up inference of the MemoryEffects of every defined function.
+///
+/// Loads and stores are classified by their underlying object: a global
+/// touches `globals`, a pointer argument touches `args`, a local `alloc`
+/// is invisible to callers. A call adds the callee's effect on globals and
+/// I/O, and its effect on arguments is mapped through the underlying
+/// object of each pointer actual. Functions start out without any effect
+/// and are re-evaluated until nothing changes, so recursion converges to
+/// the smallest consistent summary. Library declarations keep the
+/// summaries registered with them.
+///
+/// The result feeds AliasAnalysis, which lets load and store elimination
+/// look across calls, and marks pure functions.
+class FunctionAttrsPass {
+public:
+  /// @return true if some summary changed
+  bool run(Module &M);
+
+private:
+  AliasAnalysis AA_;
+
+  /// Effect a load or store through \p Ptr has on the caller of its function
+  MemoryEffects getAccessEffects(Value *Ptr, ModRefInfo MR);
+  MemoryEffects computeEffects(Function &F);
+};
+
+} // namespace nanocc
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <unordered_map>
+
+namespace nanocc {
+
+class BasicBlock;
+class DominatorTree;
+class Function;
+class Instruction;
+class LoopInfo;
+
+/// Global code motion (Click, "Global Code Motion / Global Value
+/// Numbering").
+///
+/// Pure instructions (arithmetic that cannot trap, comparisons, selects and
+/// address computations) are detached from the block they were generated
+/// in. Everything else stays pinned. Each pure instruction gets two
+/// blocks:
+///
+///   - early: the deepest block in the dominator tree that holds one of its
+///     operands, which is as high as the instruction can go;
+///   - late: the lowest common dominator of its users, which is as low as
+///     it can go.
+///
+/// The instruction is placed at the block with the smallest loop depth on
+/// the dominator tree path from late up to early. Among blocks of the same
+/// depth the lowest one wins. So loop invariants leave their loops, and
+/// values used on one branch only are computed on that branch. Within the
+/// block the instruction goes right before its first user.
+///
+/// An instruction never ends up in a deeper loop than before, since its
+/// own block lies on that path. Loads are pinned, and in this IR most
+/// operands come from loads, so most of the motion is sinking.
+class GlobalCodeMotionPass {
+public:
+  /// @return true if the function was modified
+  bool run(Function &F);
+
+private:
+  DominatorTree *DT_ = nullptr;
+  LoopInfo *LI_ = nullptr;
+  /// Depth in the dominator tree, 0 for the entry
+  std::unordered_map<BasicBlock *, unsigned> domDepth_;
+  /// Earliest legal block of each pure instruction
+  std::unordered_map<Instruction *, BasicBlock *> early_;
+
+  bool isPinned(Instruction *I);
+  BasicBlock *getBlock(Instruction *I);
+  BasicBlock *findCommonDominator(BasicBlock *A, BasicBlock *B);
+  unsigned getLoopDepth(BasicBlock *BB);
+  void scheduleEarly(Instruction *I, BasicBlock *Entry);
+  bool scheduleLate(Instruction *I);
+};
+
+} // namespace nanocc
@@ -0,0 +1,23 @@
+#pragma once
+
+namespace nanocc {
+
+class GlobalVariable;
+class Module;
+
+/// Whole-program removal of unreachable functions and globals.
+///
+/// Everything `main` reaches through calls and global references is live;
+/// other user functions, unused runtime library declarations and
+/// unreferenced globals are deleted. A global that is only ever stored to
+/// is dead as well, together with its stores.
+class GlobalDCEPass {
+public:
+  /// @return true if the module was modified
+  bool run(Module &M);
+
+private:
+  bool removeWriteOnlyGlobal(GlobalVariable *GV);
+};
+
+} // namespace nanocc
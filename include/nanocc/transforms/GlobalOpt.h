@@ -0,0 +1,37 @@
+#pragma once
+
+#include "nanocc/analysis/AliasAnalysis.h"
+
+namespace nanocc {
+
+class Function;
+class GlobalVariable;
+class Module;
+
+/// Whole-program optimization of global variables.
+///
+/// - a global that is never written, i.e. no store goes through an address
+///   derived from it and it is never handed to a call, is marked constant
+///   (`const` declarations start out constant); the backend places constant
+///   globals in `.rodata`
+/// - a load from a constant global at a constant offset is replaced by the
+///   initializer word, so lookup tables indexed by known values become
+///   immediates
+/// - a scalar global that only `main` loads and stores directly becomes a
+///   local slot of `main` initialized at entry, where the scalar memory
+///   optimizations can track it. `main` runs once, so nothing observes the
+///   difference; other functions may run repeatedly and keep their globals.
+class GlobalOptPass {
+public:
+  /// @return true if the module was modified
+  bool run(Module &M);
+
+private:
+  AliasAnalysis AA_;
+
+  bool isNeverWritten(GlobalVariable *GV);
+  bool foldLoads(Function &F);
+  bool localizeIntoMain(GlobalVariable *GV, Function *Main);
+};
+
+} // namespace nanocc
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <vector>
+
+namespace nanocc {
+
+class Function;
+class Instruction;
+
+/// Collect the calls of \p F, or return false if \p F is used any other way,
+/// such as being passed as an argument
+bool collectCallSites(Function *F, std::vector<Instruction *> &Calls);
+
+} // namespace nanocc
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "nanocc/analysis/AliasAnalysis.h"
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace nanocc {
+
+class BasicBlock;
+class Function;
+class Instruction;
+class Module;
+class Value;
+
+/// Interprocedural sparse conditional constant propagation, followed by
+/// function specialization.
+///
+/// Every integer value, argument, return value and non-escaping scalar
+/// slot gets a lattice value (unknown < constant < overdefined). Blocks
+/// become executable when a reachable branch can take them; the entry of a
+/// function whose only uses are direct calls becomes executable with its
+/// first executable call site. Arguments meet the actual values of the
+/// executable call sites, call results take the callee's return value.
+/// Slots are flow-insensitive: a load sees the meet of every executable
+/// store to its slot.
+///
+/// Afterwards constant values replace their uses, constant arguments are
+/// substituted into the callee body and branches on constant conditions
+/// are left for SimplifyCFG to fold.
+///
+/// Call sites that still pass constants deciding a branch in the callee
+/// (flags, base cases, size checks) get a copy of the callee with those
+/// arguments baked in, when the call is hot (in a loop, or the callee loops
+/// or recurses) and within a code growth budget.
+class IPSCCPPass {
+public:
+  /// @return true if the module was modified
+  bool run(Module &M);
+
+private:
+  struct LatticeVal {
+    enum State { Unknown, Constant, Overdefined } state = Unknown;
+    int32_t value = 0;
+  };
+
+  AliasAnalysis AA_;
+  /// instructions, arguments and slots; a Function maps to its return value
+  std::unordered_map<Value *, LatticeVal> values_;
+  std::unordered_set<BasicBlock *> executable_;
+  /// functions whose every use is a direct call
+  std::unordered_set<Function *> tracked_;
+  bool solverChanged_ = false;
+
+  /// instructions copied into specializations so far
+  unsigned specializedSize_ = 0;
+  std::unordered_map<Function *, unsigned> numSpecializations_;
+
+  LatticeVal getValue(Value *V);
+  void mergeIn(Value *V, LatticeVal L);
+  void markExecutable(BasicBlock *BB);
+  void visit(Instruction *I);
+  void solve(Module &M);
+  bool rewrite(Module &M);
+  bool propagate(Module &M);
+
+  bool isTrackedSlot(Value *V);
+
+  /// Instructions of \p F that fold once argument \p ArgNo is constant,
+  /// or 0 when none of them decides a branch
+  unsigned getSpecializationBonus(Function *F, unsigned ArgNo);
+  bool specialize(Module &M);
+};
+
+} // namespace nanocc
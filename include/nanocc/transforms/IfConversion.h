@@ -0,0 +1,46 @@
+#pragma once
+
+#include "nanocc/analysis/AliasAnalysis.h"
+#include <vector>
+
+namespace nanocc {
+
+class BasicBlock;
+class Function;
+class Value;
+
+/// Flatten small if/else diamonds and if-then triangles that only compute
+/// values and store them into `select`s, removing the branch.
+///
+///   H: ...; br c, T, F               H: ...; <T code>; <F code>
+///   T: <T code>; store a, %p; jump J     %s = select c, a, b
+///   F: <F code>; store b, %p; jump J =>  store %s, %p; jump J
+///   J: ...                           J: ...
+///
+/// A triangle `br c, T, J` stores into a word that keeps its old value on
+/// the other side: `store (select c, a, (load %p)), %p`.
+///
+/// Both sides run unconditionally afterwards, so every instruction in them
+/// must be safe to execute on either path: arithmetic (no division by a
+/// value that may be zero), address computation, loads from locals and
+/// globals or from addresses H already accesses, and stores to such
+/// addresses computed before H. No load may follow a store on the same
+/// side, and the words stored must not overlap. Sides above MaxArmSize
+/// instructions are left alone, since the backend lowers each select into
+/// a short sequence of its own.
+class IfConversionPass {
+public:
+  /// @return true if the function was modified
+  bool run(Function &F);
+
+private:
+  AliasAnalysis AA_;
+  /// Addresses loaded or stored by the block being converted
+  std::vector<Value *> accessed_;
+
+  bool isSafeAddress(Value *Ptr);
+  bool canSpeculate(BasicBlock *Arm);
+  bool convert(BasicBlock *Head);
+};
+
+} // namespace nanocc
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <unordered_set>
+#include <vector>
+
+namespace nanocc {
+
+class Function;
+class Instruction;
+class Value;
+
+/// Peephole combining of binary operations, selects and branches.
+///
+/// - algebraic identities: x+0, x*1, x-x, -(-x), x*0, ...
+/// - redundant boolean normalization: `ne b, 0` where b is already 0/1,
+///   `eq (lt a, b), 0` -> `ge a, b`, branches and selects on `ne x, 0` /
+///   `eq x, 0`, `select b, 1, 0` -> b
+/// - strength reduction: mul by a power of two -> shl,
+///   mod by a power of two -> and when the dividend is non-negative
+///
+/// Runs a worklist to a fixpoint; users of rewritten values are revisited.
+class InstCombinePass {
+public:
+  /// @return true if the function was modified
+  bool run(Function &F);
+
+private:
+  std::vector<Instruction *> worklist_;
+  std::unordered_set<Instruction *> inWorklist_;
+
+  void push(Value *V);
+  void pushUsers(Value *V);
+  void eraseInst(Instruction *I);
+  void replaceInst(Instruction *I, Value *V);
+
+  /// @return a value equivalent to \p I, or nullptr if nothing applies
+  Value *visitBinaryOp(Instruction *I);
+  Value *visitMul(Instruction *I);
+  Value *visitCompare(Instruction *I);
+  Value *visitSelect(Instruction *I);
+
+  /// @return true if the branch was rewritten
+  bool visitBranch(Instruction *I);
+};
+
+} // namespace nanocc
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "nanocc/analysis/AliasAnalysis.h"
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace nanocc {
+
+class BasicBlock;
+class Function;
+class Instruction;
+class Value;
+
+/// Redundant load elimination and store-to-load forwarding.
+///
+/// Tracks which value each pointer is known to hold: a `store v, p` makes
+/// `v` available at `p`, a `load p` makes its own result available. A later
+/// load from a must-alias pointer is replaced by that value. Stores kill
+/// every entry they may alias, calls kill whatever the callee may modify.
+/// A call to a pure function is available as well: a later call with the
+/// same arguments reuses its result.
+///
+/// Availability flows forward over the CFG as the intersection of the
+/// predecessors; a predecessor not yet visited (a back edge) contributes
+/// nothing, so a single pass in layout order is enough.
+class LoadElimPass {
+public:
+  /// @return true if the function was modified
+  bool run(Function &F);
+
+private:
+  /// pointer -> value currently stored there; pure calls map to themselves
+  using AvailableValues = std::vector<std::pair<Value *, Value *>>;
+
+  AliasAnalysis AA_;
+  std::unordered_map<BasicBlock *, AvailableValues> blockOut_;
+
+  Value *lookup(const AvailableValues &Avail, Value *Ptr);
+  Value *lookupCall(const AvailableValues &Avail, Instruction *Call);
+  void clobber(AvailableValues &Avail, Instruction *I);
+  AvailableValues mergePredecessors(BasicBlock *BB);
+  bool processBlock(BasicBlock *BB);
+};
+
+} // namespace nanocc
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "nanocc/analysis/AliasAnalysis.h"
+
+namespace nanocc {
+
+class BasicBlock;
+class Function;
+class Loop;
+class Value;
+
+/// Delete loops that compute nothing used afterwards.
+///
+/// A loop qualifies if it is a counted loop (see CountedLoop) whose bound
+/// nothing in the loop modifies, so it always terminates, and it has no
+/// inner loops, calls or stores other than to non-escaping int locals.
+/// Each local it stores must be dead after the loop: every path from the
+/// exit stores it before loading it, or returns. The induction variable
+/// may stay live if the trip count is a constant; its final value is
+/// stored in the preheader instead. The preheader then jumps straight to
+/// the exit.
+///
+/// Inner loops are visited first, so a nest whose inner loops are deleted
+/// can go as a whole.
+class LoopDeletionPass {
+public:
+  /// @return true if the function was modified
+  bool run(Function &F);
+
+private:
+  AliasAnalysis AA_;
+
+  bool runOnLoop(Loop *L);
+};
+
+} // namespace nanocc
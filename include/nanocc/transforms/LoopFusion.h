@@ -0,0 +1,45 @@
+#pragma once
+
+#include "nanocc/analysis/AliasAnalysis.h"
+
+namespace nanocc {
+
+class Function;
+class Loop;
+
+/// Merge adjacent counted loops (see CountedLoop) that run the same
+/// iterations into one loop.
+///
+///   P:  store a, %i; jump H1         P:  store a, %i; store a, %j
+///   H1: ...; lt %i, n; br B1, M          jump H1
+///   B1: ...; %i += s; jump H1    =>  H1: ...; lt %i, n; br B1, X
+///   M:  store a, %j; jump H2         B1: ...; jump B2
+///   H2: ...; lt %j, n; br B2, X      B2: ...; %j += s; %i += s; jump H1
+///   B2: ...; %j += s; jump H2
+///
+/// Both loops need the same start, bound and step, where the bound is a
+/// value that neither loop modifies. The block between the loops may only
+/// start the second one. Loops counting in the same slot share it.
+///
+/// Iteration k of the second loop now runs before iterations k+1.. of the
+/// first. Array accesses are compared with DependenceAnalysis, mapping the
+/// second loop's variable onto the first: the fusion is legal if no word
+/// the first loop touches at iteration k is accessed by the second loop at
+/// an earlier iteration, with at least one of the two a write. Locals and
+/// global scalars written by one loop may not be accessed by the other,
+/// and neither loop may call a function that touches memory. Unless the
+/// variable is shared, this includes each loop's own variable: the first
+/// loop's is no longer final when the second reads it, and the second's
+/// is set before the first loop starts.
+class LoopFusionPass {
+public:
+  /// @return true if the function was modified
+  bool run(Function &F);
+
+private:
+  AliasAnalysis AA_;
+
+  bool fuse(Loop *First, Loop *Second);
+};
+
+} // namespace nanocc
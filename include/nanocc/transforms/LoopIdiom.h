@@ -0,0 +1,39 @@
+#pragma once
+
+#include "nanocc/analysis/AliasAnalysis.h"
+
+namespace nanocc {
+
+class Function;
+class Loop;
+class Module;
+
+/// Replace element-wise fill and copy loops with calls to the runtime
+/// memset/memcpy routines (see RuntimeLib).
+///
+/// Recognized shape, after the memory optimizations have run:
+///
+///   header: %i = load %iv; ...; %c = lt %i, %n; br %c, body, exit
+///   body:   a[%i] = v          (v loop invariant)       -> memset
+///           a[%k] = b[%j]                               -> memcpy
+///           %iv = %i + 1; ...  (every induction slot steps by one)
+///           jump header
+///
+/// Addresses are matched through AliasAnalysis::decompose: the only variable
+/// part must be an induction variable with a stride of one word. The body
+/// is replaced by one call plus the final induction variable values.
+class LoopIdiomPass {
+public:
+  explicit LoopIdiomPass(Module &M) : M_(M) {}
+
+  /// @return true if the function was modified
+  bool run(Function &F);
+
+private:
+  Module &M_;
+  AliasAnalysis AA_;
+
+  bool runOnLoop(Loop *L);
+};
+
+} // namespace nanocc
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "nanocc/analysis/AliasAnalysis.h"
+#include <unordered_set>
+
+namespace nanocc {
+
+class BasicBlock;
+class Function;
+class Loop;
+
+/// Reorder perfect two-deep loop nests for cache locality.
+///
+/// A nest qualifies when both loops are counted loops (see CountedLoop)
+/// from a constant start to a constant bound in steps of one, each running
+/// at least once, and the outer loop does nothing but run the inner one:
+///
+///   OH: %i = load %I; lt %i, N; br OB, exit
+///   OB: store j0, %J; jump IH
+///   IH: %j = load %J; lt %j, M; br body, IX
+///   ... body ...; latch: J += 1; jump IH
+///   IX: I += 1; jump OH
+///
+/// Interchange swaps the loops when that turns strided array accesses of
+/// the inner loop into unit-stride ones. Each subscript is an affine
+/// expression of the two induction variables (see DependenceAnalysis);
+/// the swap is legal unless a dependence runs forward in one variable and
+/// backward in the other. Apart from arrays the body may only update
+/// locals by `s = s + x` reductions and call functions that do not touch
+/// memory.
+///
+/// Tiling strip-mines the inner loop into tiles of T iterations and runs
+/// the outer loop once per tile, when the data the inner loop sweeps does
+/// not fit the data cache but is reused by the next outer iteration:
+///
+///   for (jj = j0; jj < M; jj += T)
+///     for (i = i0; i < N; ++i)
+///       for (j = jj; j < jj + T; ++j) ...
+///
+/// T is a power of two dividing the trip count, chosen so a tile fills
+/// at most half of the cache. Both loops end with the same induction
+/// variable values as before, so the slots may be read after the nest.
+class LoopNestPass {
+public:
+  /// @return true if the function was modified
+  bool run(Function &F);
+
+private:
+  AliasAnalysis AA_;
+  /// Outer headers of nests already looked at
+  std::unordered_set<BasicBlock *> visited_;
+
+  bool runOnLoop(Loop *L);
+};
+
+} // namespace nanocc
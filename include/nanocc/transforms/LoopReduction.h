@@ -0,0 +1,51 @@
+#pragma once
+
+#include "nanocc/analysis/AliasAnalysis.h"
+#include <unordered_set>
+
+namespace nanocc {
+
+class BasicBlock;
+class Function;
+class Loop;
+
+/// Split reductions over a loop into NumAccumulators independent partial
+/// results, unrolling the loop by the same factor.
+///
+/// A reduction is a non-escaping int local `s` that the loop only touches
+/// through
+///
+///   s = s op x        op: add, mul, and, or, xor, or
+///   if (x > s) s = x  (and the <, <=, >= forms: max or min)
+///
+/// where x does not depend on s. Copy k of the unrolled body accumulates
+/// into its own local, started at the identity of op, so the copies do
+/// not wait for each other:
+///
+///   main:   while (i < n - (K-1)*step) { body(s0); body(s1); ...; }
+///   rest:   while (i < n) body(s0);
+///   reduce: s0 = s0 op s1 op ... op s(K-1)
+///
+/// The copies run the iterations in their original order; only the
+/// combination of the accumulators is reassociated, which is exact for
+/// wrapping integer arithmetic, min and max.
+///
+/// The loop must be a counted loop (see CountedLoop) whose header only
+/// computes the test, with a bound the loop does not modify and no inner
+/// loops. For a bound that is not a constant the count must start at a
+/// constant >= 0, so `n - (K-1)*step` cannot wrap around. Bodies above
+/// MaxBodySize instructions are left alone.
+class LoopReductionPass {
+public:
+  /// @return true if the function was modified
+  bool run(Function &F);
+
+private:
+  AliasAnalysis AA_;
+  /// Headers of loops already split or created by a split
+  std::unordered_set<BasicBlock *> visited_;
+
+  bool runOnLoop(Loop *L);
+};
+
+} // namespace nanocc
@@ -0,0 +1,34 @@
+#pragma once
+
+namespace nanocc {
+
+class Function;
+class Loop;
+
+/// Turn top-tested while loops into a guarded do-while.
+///
+///   preheader: jump header              preheader: header'; br c', body, exit
+///   header:    ...; br c, body, exit    body:      ...
+///   body:      ...                  =>  latch:     header''; br c'', body, exit
+///   latch:     jump header
+///
+/// The header is copied into the preheader as the entry guard and onto every
+/// back edge, then deleted, so each iteration ends in one conditional branch
+/// instead of a jump back to the test. Values of the header used further
+/// down are recomputed at the top of the body (and of the exit, if the
+/// header is its only predecessor); this requires a header without stores
+/// or calls, so the copy sees the same memory. The later memory
+/// optimizations usually forward the copies on the guard and back edges.
+///
+/// Loops whose latch already exits are left alone, so a loop is rotated at
+/// most once. The header is limited to MaxHeaderSize instructions.
+class LoopRotatePass {
+public:
+  /// @return true if the function was modified
+  bool run(Function &F);
+
+private:
+  bool runOnLoop(Loop *L);
+};
+
+} // namespace nanocc
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "nanocc/analysis/AliasAnalysis.h"
+#include <unordered_map>
+
+namespace nanocc {
+
+class Function;
+class Loop;
+class Value;
+
+/// Hoist loop-invariant conditional branches out of loops by versioning
+/// the loop.
+///
+///   preheader: jump header          preheader: c' = <c>; br c', L1, L2
+///   L:  ...; br c, then, else   =>  L1: ...; br 1, then, else
+///                                   L2: ...; br 0, then', else'
+///
+/// A condition is invariant if it is computed from values defined outside
+/// the loop, loads from a fixed global or local word that nothing in the
+/// loop may modify (per AliasAnalysis), and arithmetic on those. Its
+/// computation is copied into the preheader; only instructions that are
+/// safe to execute unconditionally qualify (no division by a value that
+/// may be zero). SimplifyCFG then folds the constant branches so each copy
+/// runs without the test.
+///
+/// Only loops whose values are not used after the loop are versioned, and
+/// each copy adds the whole loop to the function: loops above
+/// MaxLoopSize instructions are skipped and a function grows by at most
+/// FunctionGrowthBudget instructions.
+class LoopUnswitchPass {
+public:
+  /// @return true if the function was modified
+  bool run(Function &F);
+
+private:
+  AliasAnalysis AA_;
+  std::unordered_map<Value *, bool> invariant_;
+  unsigned budget_ = 0;
+
+  bool isInvariantCondition(Value *V, Loop *L);
+  bool isInvariantLoad(Instruction *Load, Loop *L);
+  bool runOnLoop(Loop *L);
+};
+
+} // namespace nanocc
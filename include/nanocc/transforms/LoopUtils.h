@@ -0,0 +1,80 @@
+#pragma once
+
+#include "nanocc/ir/Instruction.h"
+#include "nanocc/transforms/Cloning.h"
+#include <cstdint>
+#include <functional>
+
+namespace nanocc {
+
+class AliasAnalysis;
+class BasicBlock;
+class Function;
+class IRBuilder;
+class Loop;
+class LoopInfo;
+class Value;
+
+/// Call \p Fn on the loops of \p F, innermost first, until no call reports a
+/// change. The loop nest is rebuilt after every change, so \p Fn may rewrite
+/// the CFG freely before returning true.
+/// @return whether any call changed \p F
+bool runOnLoopsUntilFixpoint(Function &F,
+                             const std::function<bool(Loop *, LoopInfo &)> &Fn);
+
+/// \p V as an instruction with opcode \p Op, nullptr if it is not one
+Instruction *asOpcode(Value *V, Instruction::Opcode Op);
+
+/// Whether every use of \p I is in \p User
+bool usedOnlyBy(Instruction *I, Instruction *User);
+
+/// Erase \p I if nothing uses it
+void eraseIfDead(Instruction *I);
+
+/// Return the preheader of \p L, first routing every edge that enters the
+/// header from outside the loop through a new block if there is none.
+/// @note the new block is not added to the LoopInfo the loop came from
+BasicBlock *insertPreheader(Loop *L);
+
+/// Unlink \p I from its block and insert it before \p Pos
+void moveBefore(Instruction *I, Instruction *Pos);
+
+/// Copy the instructions of \p BB before the insertion point of \p Builder,
+/// the terminator only if \p WithTerminator. Operands are remapped through
+/// \p VMap, which records each copy.
+void cloneInstructions(BasicBlock *BB, IRBuilder &Builder, ValueMap &VMap,
+                       bool WithTerminator);
+
+/// Move the `alloc` \p Alloc to the top of the entry block, where it
+/// dominates the whole function
+void hoistToEntry(Instruction *Alloc);
+
+/// A top-tested loop counting a local up to a bound:
+///
+///   preheader: ...; store init, %iv; jump header
+///   header:    %i = load %iv; ...; %c = lt %i, bound; br %c, body, exit
+///   latch:     ...; store (add (load %iv), step), %iv; jump header
+///
+/// The header is the only exiting block and the latch store is the only
+/// store to `%iv`, a non-escaping i32 local, inside the loop.
+struct CountedLoop {
+  Loop *L = nullptr;
+  BasicBlock *header = nullptr;
+  BasicBlock *body = nullptr; ///< in-loop successor of the header
+  BasicBlock *exit = nullptr;
+  BasicBlock *latch = nullptr;
+  Value *slot = nullptr;
+  Instruction *cmp = nullptr;
+  Value *bound = nullptr;
+  Instruction *stepStore = nullptr;
+  int64_t step = 0;
+  /// Value stored to the slot in the preheader, if any
+  Value *init = nullptr;
+};
+
+bool matchCountedLoop(Loop *L, AliasAnalysis &AA, CountedLoop &CL);
+
+/// Number of iterations if init, bound and step are constants, -1 otherwise
+int64_t getConstantTripCount(const CountedLoop &CL);
+
+} // namespace nanocc
@@ -0,0 +1,38 @@
+#pragma once
+
+namespace nanocc {
+
+class Function;
+class Module;
+
+/// Automatic memoization of pure recursive integer functions (opt-in, see
+/// PipelineOptions::memoize).
+///
+/// A candidate is a pure function (MemoryEffects::isPure) of type
+/// `i32 f(i32)` or `i32 f(i32, i32)` that calls itself at least twice, the
+/// tree-shaped recursion where the same subcalls are recomputed
+/// exponentially often. Its body is wrapped as
+///
+///   entry:  in range? -> check, otherwise run the original body
+///   check:  table[idx].valid ? return table[idx].value
+///   ret x:  if in range, table[idx] = {1, x}; ret x
+///
+/// The table is a zero-initialized global with one `{valid, value}` pair
+/// per argument tuple in a fixed range: [0, MemoTableSize) for one
+/// argument, [0, MemoRows) x [0, MemoCols) for two. Arguments outside the
+/// range take the plain recursive path, so memory use is bounded by
+/// MaxMemoizedFunctions tables no matter what the program does.
+///
+/// The table is private to the function, so callers still see a pure
+/// function and its MemoryEffects are left unchanged.
+class MemoizePass {
+public:
+  /// @return true if the module was modified
+  bool run(Module &M);
+
+private:
+  bool isCandidate(Function &F);
+  void memoize(Function &F, Module &M);
+};
+
+} // namespace nanocc
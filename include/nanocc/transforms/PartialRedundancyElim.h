@@ -0,0 +1,105 @@
+#pragma once
+
+#include "nanocc/analysis/AliasAnalysis.h"
+#include "nanocc/ir/Instruction.h"
+#include <bitset>
+#include <unordered_map>
+#include <vector>
+
+namespace nanocc {
+
+class BasicBlock;
+class Function;
+class Value;
+
+/// Partial redundancy elimination by lazy code motion (Knoop, Rüthing and
+/// Steffen, in the edge-based form of Drechsler and Stadel).
+///
+/// An expression is a binary operation on variables and constants, where a
+/// variable is an int local that does not escape or an int global, read by
+/// a load in the same block:
+///
+///   %1 = load %a; %2 = load %b; %3 = add %1, %2      is   a + b
+///
+/// Stores to a variable, and calls that may modify it, kill the
+/// expressions that read it. Four bit-vector problems over the CFG
+/// (availability, anticipability, earliest and later placement) give
+/// the edges where an expression has to be inserted and the computations
+/// that become redundant. Those are replaced by a load of a new local
+/// that holds the value. The result is computationally optimal: no path
+/// evaluates an expression more often than before, and insertions are
+/// pushed as late as possible. A loop invariant computed at the top of the
+/// loop, such as the bound in `while (i < n * m)`, moves to the preheader.
+///
+/// The local lives in memory, so an expression is left alone when it would
+/// be stored inside a loop to save computations outside of it.
+///
+/// Inserting on a critical edge splits it. Only depth-one expressions are
+/// handled in one run; replacing an operand by a load of the new local
+/// lets the enclosing expression be handled by the next run. At most
+/// MaxExpressions distinct expressions are tracked per function.
+class PartialRedundancyElimPass {
+public:
+  static constexpr size_t MaxExpressions = 128;
+
+  /// @return true if the function was modified
+  bool run(Function &F);
+
+private:
+  using ExprSet = std::bitset<MaxExpressions>;
+
+  /// A variable (the address it is loaded from) or a constant
+  struct Operand {
+    Value *var = nullptr;
+    int value = 0;
+
+    bool operator==(const Operand &Other) const {
+      return var == Other.var && (var || value == Other.value);
+    }
+  };
+
+  struct Expression {
+    Instruction::Opcode opcode;
+    Operand lhs, rhs;
+    /// Local holding the value where the computation was removed
+    Value *temp = nullptr;
+  };
+
+  /// A computation of an expression in a block
+  struct Occurrence {
+    Instruction *inst;
+    size_t expr;
+    /// Not killed since the block entry
+    bool upwardExposed;
+    /// Earlier computation in the block with the same value, or nullptr
+    Instruction *previous;
+  };
+
+  struct BlockInfo {
+    std::vector<Occurrence> occurrences;
+    /// Local properties: computed before any kill, computed after the last
+    /// kill, not killed at all
+    ExprSet antloc, comp, transp;
+    ExprSet availOut, antIn, antOut, laterIn;
+    /// The value must be in the expression's local on leaving the block
+    ExprSet neededOut;
+  };
+
+  AliasAnalysis AA_;
+  std::vector<Expression> exprs_;
+  /// Expression computed by each binary operation that is one
+  std::unordered_map<Instruction *, size_t> exprOf_;
+  /// Expressions reading each variable
+  std::unordered_map<Value *, ExprSet> readers_;
+  std::unordered_map<BasicBlock *, BlockInfo> info_;
+
+  bool isVariable(Value *Ptr);
+  bool getOperand(Instruction *I, Value *V, Operand &Op);
+  void addExpression(Instruction *I);
+  void collectKills(Instruction *I, ExprSet &Kills);
+  void computeLocalProperties(BasicBlock *BB);
+  Value *getTemp(size_t E, Function &F);
+  Value *materialize(const Expression &E, Instruction *InsertBefore);
+};
+
+} // namespace nanocc
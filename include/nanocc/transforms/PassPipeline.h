@@ -0,0 +1,22 @@
+#pragma once
+
+namespace nanocc {
+
+class Module;
+
+/// Optional transformations, all off by default
+struct PipelineOptions {
+  /// Cache the results of pure recursive functions, see MemoizePass
+  bool memoize = false;
+  /// Flatten small branches into selects, see IfConversionPass. Every IR
+  /// value lives in a stack slot, so a select costs several instructions
+  /// more than a well predicted branch; it pays off for branches on data
+  /// that do not follow a pattern.
+  bool ifConvert = false;
+};
+
+/// Run the default optimization pipeline over every function defined in
+/// \p M. Declarations (library functions) are left untouched.
+void runOptimizationPipeline(Module &M, const PipelineOptions &Opts = {});
+
+} // namespace nanocc
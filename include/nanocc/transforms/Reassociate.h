@@ -0,0 +1,69 @@
+#pragma once
+
+#include "nanocc/ir/Instruction.h"
+#include <unordered_map>
+#include <vector>
+
+namespace nanocc {
+
+class Function;
+class Value;
+
+/// Rewrite chains of associative and commutative operations (add/sub, mul,
+/// and, or, xor) into a canonical order, so that constants fold and equal
+/// subexpressions are built the same way.
+///
+///   %1 = add %a, 1                    %1 = add %a, 3
+///   %2 = add %1, 2             =>
+///
+///   %1 = shl %i, 2; %2 = shl %j, 2    %1 = add %i, %j
+///   %3 = add %1, %2; %4 = add %3, 8   %2 = shl %1, 2; %3 = add %2, 8
+///
+/// Each value gets a rank: 0 for constants, then increasing with the
+/// position of arguments and other instructions in reverse postorder; an
+/// operation in a chain takes the highest rank of its operands. A chain is
+/// flattened into its leaves, following operations with a single use in
+/// the same block. Then:
+///
+///   - constants combine into one, placed last (`x + c`, `x * c`);
+///   - `x` and `-x` cancel in a sum, equal operands in `xor`, and
+///     repeated operands of `and` and `or` merge;
+///   - terms of a sum with the same constant factor share one
+///     multiplication or shift;
+///   - the remaining leaves are combined lowest rank first, so values
+///     defined early (e.g. outside a loop) form a common subexpression.
+///
+/// `x - y` is a sum with a negated leaf. Arithmetic wraps around in two's
+/// complement, so the rewrite is exact.
+class ReassociatePass {
+public:
+  /// @return true if the function was modified
+  bool run(Function &F);
+
+private:
+  /// A leaf of a chain; negated leaves only occur in sums
+  struct Operand {
+    Value *value;
+    bool negated = false;
+  };
+
+  std::unordered_map<Value *, unsigned> rank_;
+  /// Multiplications and shifts replaced by a common factor
+  std::vector<Instruction *> factored_;
+
+  unsigned getRank(Value *V);
+  bool isRoot(Instruction *I);
+  bool canFlatten(Value *V, Instruction::Opcode Op, Instruction *Root);
+  void flatten(Instruction *I, bool Negated, Instruction *Root,
+               std::vector<Operand> &Leaves, std::vector<Instruction *> &Nodes);
+  bool factorSum(std::vector<Operand> &Leaves, Instruction *InsertBefore);
+  Value *buildChain(Instruction::Opcode Op, std::vector<Operand> &Leaves,
+                    Instruction *InsertBefore);
+  bool rewrite(Instruction *Root);
+
+  /// Constants compare by value
+  static bool isSameLeaves(const std::vector<Operand> &A,
+                           const std::vector<Operand> &B);
+};
+
+} // namespace nanocc
@@ -0,0 +1,34 @@
+#pragma once
+
+namespace nanocc {
+
+class BasicBlock;
+class Function;
+
+/// Control flow graph cleanup.
+///
+/// - removes blocks unreachable from the entry
+/// - folds `br` on a constant or with identical targets into `jump`
+/// - removes forwarding blocks that contain nothing but a `jump`
+/// - merges a block into its predecessor when that is the only edge
+/// - threads edges through blocks whose branch condition is known on the
+///   incoming edge: `br c` reached from another `br c`, or a branch on a
+///   local flag that the predecessor has just stored (`and_end`/`or_end`)
+///
+/// Runs to a fixpoint and finally lays blocks out in reverse postorder so
+/// definitions keep preceding their uses in the emitted text.
+class SimplifyCFGPass {
+public:
+  /// @return true if the function was modified
+  bool run(Function &F);
+
+private:
+  bool removeUnreachableBlocks(Function &F);
+  bool foldBranch(BasicBlock *BB);
+  bool removeForwardingBlock(BasicBlock *BB);
+  bool mergeIntoPredecessor(BasicBlock *BB);
+  bool threadEdges(BasicBlock *BB);
+  void layoutBlocks(Function &F);
+};
+
+} // namespace nanocc
@@ -0,0 +1,185 @@
+#include "nanocc/analysis/AliasAnalysis.h"
+#include "nanocc/ir/Constant.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/GlobalVariable.h"
+#include "nanocc/ir/Instruction.h"
+#include "nanocc/ir/Type.h"
+#include "nanocc/ir/Value.h"
+#include <algorithm>
+
+namespace nanocc {
+
+using Opcode = Instruction::Opcode;
+
+/// Size of \p T counted in i32 words
+static int64_t getSizeInWords(Type *T) {
+  if (T->isArrayTy())
+    return T->getArrayNumElements() * getSizeInWords(T->getArrayElementType());
+  return 1;
+}
+
+static Instruction *asOpcode(Value *V, Opcode op) {
+  auto *I = dynamic_cast<Instruction *>(V);
+  return (I && I->getOpcode() == op) ? I : nullptr;
+}
+
+static bool isIdentifiedObject(Value *V) {
+  return asOpcode(V, Opcode::Alloc) || dynamic_cast<GlobalVariable *>(V);
+}
+
+/// `%p = alloc *i32; store %arg, %p` with no other store: loads of %p
+/// yield the incoming pointer argument.
+static Argument *getArgumentInSlot(Value *Slot) {
+  auto *slot = asOpcode(Slot, Opcode::Alloc);
+  if (!slot || !slot->getType()->getPointerElementType()->isPointerTy())
+    return nullptr;
+
+  Argument *arg = nullptr;
+  for (Use *U = slot->use_begin(); U != slot->use_end(); U = U->getNext()) {
+    auto *user = static_cast<Instruction *>(U->getUser());
+    if (user->getOpcode() == Opcode::Load)
+      continue;
+    if (user->getOpcode() != Opcode::Store || user->getOperand(1) != slot ||
+        arg)
+      return nullptr;
+    arg = dynamic_cast<Argument *>(user->getOperand(0));
+    if (!arg)
+      return nullptr;
+  }
+  return arg;
+}
+
+PointerDecomposition AliasAnalysis::decompose(Value *Ptr) {
+  PointerDecomposition D;
+  Value *V = Ptr;
+  while (auto *I = dynamic_cast<Instruction *>(V)) {
+    if (I->getOpcode() == Opcode::GetElemPtr ||
+        I->getOpcode() == Opcode::GetPtr) {
+      // getelemptr steps into the array, getptr steps over whole elements
+      Type *elemTy = I->getOperand(0)->getType()->getPointerElementType();
+      if (I->getOpcode() == Opcode::GetElemPtr && elemTy->isArrayTy())
+        elemTy = elemTy->getArrayElementType();
+      int64_t stride = getSizeInWords(elemTy);
+
+      Value *idx = I->getOperand(1);
+      if (auto *C = dynamic_cast<ConstantInt *>(idx)) {
+        D.offset += C->getValue() * stride;
+      } else {
+        auto it = std::find_if(D.varIndices.begin(), D.varIndices.end(),
+                               [&](const auto &P) { return P.first == idx; });
+        if (it != D.varIndices.end())
+          it->second += stride;
+        else
+          D.varIndices.emplace_back(idx, stride);
+      }
+      V = I->getOperand(0);
+      continue;
+    }
+    if (I->getOpcode() == Opcode::Load) {
+      if (Argument *arg = getArgumentInSlot(I->getOperand(0)))
+        V = arg;
+    }
+    break;
+  }
+  D.base = V;
+  std::sort(D.varIndices.begin(), D.varIndices.end());
+  return D;
+}
+
+bool AliasAnalysis::isNonEscapingLocal(Value *V) {
+  if (!asOpcode(V, Opcode::Alloc))
+    return false;
+  auto cached = escapeCache_.find(V);
+  if (cached != escapeCache_.end())
+    return cached->second;
+
+  bool escapes = false;
+  std::vector<Value *> worklist{V};
+  while (!worklist.empty() && !escapes) {
+    Value *P = worklist.back();
+    worklist.pop_back();
+    for (Use *U = P->use_begin(); U != P->use_end(); U = U->getNext()) {
+      auto *user = static_cast<Instruction *>(U->getUser());
+      switch (user->getOpcode()) {
+      case Opcode::Load:
+        break;
+      case Opcode::Store:
+        // storing *to* the object is fine, storing its address is not
+        escapes |= user->getOperand(0) == P;
+        break;
+      case Opcode::GetElemPtr:
+      case Opcode::GetPtr:
+        worklist.push_back(user);
+        break;
+      default:
+        escapes = true;
+        break;
+      }
+    }
+  }
+  escapeCache_[V] = !escapes;
+  return !escapes;
+}
+
+bool AliasAnalysis::mayShareObject(Value *BaseA, Value *BaseB) {
+  if (BaseA == BaseB)
+    return true;
+  if (isIdentifiedObject(BaseA) && isIdentifiedObject(BaseB))
+    return false;
+  // nothing but the local itself can point into a non-escaping local
+  if (isNonEscapingLocal(BaseA) || isNonEscapingLocal(BaseB))
+    return false;
+  return true;
+}
+
+AliasResult AliasAnalysis::alias(Value *A, Value *B) {
+  if (A == B)
+    return AliasResult::MustAlias;
+
+  PointerDecomposition DA = decompose(A);
+  PointerDecomposition DB = decompose(B);
+  if (!mayShareObject(DA.base, DB.base))
+    return AliasResult::NoAlias;
+  if (DA.base != DB.base || DA.varIndices != DB.varIndices)
+    return AliasResult::MayAlias;
+  // same object and same variable part: only the constant offset differs
+  return DA.offset == DB.offset ? AliasResult::MustAlias
+                                : AliasResult::NoAlias;
+}
+
+MemoryEffects AliasAnalysis::getMemoryEffects(Instruction *Call) {
+  auto *callee = dynamic_cast<Function *>(Call->getOperand(0));
+  return callee ? callee->getMemoryEffects() : MemoryEffects();
+}
+
+ModRefInfo AliasAnalysis::getModRefInfo(Instruction *I, Value *Ptr) {
+  switch (I->getOpcode()) {
+  case Opcode::Load:
+    return alias(I->getOperand(0), Ptr) == AliasResult::NoAlias ? NoModRef
+                                                                : Ref;
+  case Opcode::Store:
+    return alias(I->getOperand(1), Ptr) == AliasResult::NoAlias ? NoModRef
+                                                                : Mod;
+  case Opcode::Call: {
+    Value *base = getUnderlyingObject(Ptr);
+    if (isNonEscapingLocal(base))
+      return NoModRef;
+
+    MemoryEffects S = getMemoryEffects(I);
+    ModRefInfo result = S.globals;
+    if (S.args == NoModRef)
+      return result;
+    for (unsigned i = 1; i < I->getNumOperands(); ++i) {
+      Value *arg = I->getOperand(i);
+      if (arg->getType()->isPointerTy() &&
+          mayShareObject(getUnderlyingObject(arg), base))
+        result |= S.args;
+    }
+    return result;
+  }
+  default:
+    return NoModRef;
+  }
+}
+
+} // namespace nanocc
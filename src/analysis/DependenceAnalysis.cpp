@@ -0,0 +1,193 @@
+#include "nanocc/analysis/DependenceAnalysis.h"
+#include "nanocc/analysis/LoopInfo.h"
+#include "nanocc/ir/BasicBlock.h"
+#include "nanocc/ir/Constant.h"
+#include "nanocc/ir/GlobalVariable.h"
+#include "nanocc/ir/Instruction.h"
+#include "nanocc/ir/Type.h"
+#include <algorithm>
+
+namespace nanocc {
+
+using Opcode = Instruction::Opcode;
+
+DependenceAnalysis::DependenceAnalysis(Loop *L,
+                                       const std::vector<Value *> &IVSlots,
+                                       AliasAnalysis &AA)
+    : L_(L), ivSlots_(IVSlots), AA_(AA) {
+  for (BasicBlock *BB : L->getBlocks())
+    for (auto &I : BB->getInstList())
+      if (I->getOpcode() == Opcode::Store)
+        storedSlots_.insert(I->getOperand(1));
+}
+
+Value *DependenceAnalysis::getInvariantSlot(Value *V) {
+  auto *load = dynamic_cast<Instruction *>(V);
+  if (!load || load->getOpcode() != Opcode::Load)
+    return nullptr;
+  auto *slot = dynamic_cast<Instruction *>(load->getOperand(0));
+  if (!slot || slot->getOpcode() != Opcode::Alloc ||
+      !slot->getType()->getPointerElementType()->isIntegerTy() ||
+      storedSlots_.count(slot) || !AA_.isNonEscapingLocal(slot))
+    return nullptr;
+  return slot;
+}
+
+static void addScaled(AffineExpr &Dst, const AffineExpr &Src, int64_t Scale) {
+  for (auto &[term, coeff] : Src.terms) {
+    int64_t &c = Dst.terms[term];
+    c += coeff * Scale;
+    if (c == 0)
+      Dst.terms.erase(term);
+  }
+  Dst.constant += Src.constant * Scale;
+}
+
+std::optional<AffineExpr> DependenceAnalysis::getAffine(Value *V) {
+  AffineExpr E;
+  if (auto *C = dynamic_cast<ConstantInt *>(V)) {
+    E.constant = C->getValue();
+    return E;
+  }
+  auto *I = dynamic_cast<Instruction *>(V);
+  if (!I || !L_->contains(I->getParent())) {
+    E.terms[V] = 1;
+    return E;
+  }
+
+  if (I->getOpcode() == Opcode::Load) {
+    Value *slot = I->getOperand(0);
+    if (std::find(ivSlots_.begin(), ivSlots_.end(), slot) == ivSlots_.end())
+      slot = getInvariantSlot(I);
+    if (!slot)
+      return std::nullopt;
+    E.terms[slot] = 1;
+    return E;
+  }
+
+  if (I->getOpcode() != Opcode::Add && I->getOpcode() != Opcode::Sub &&
+      I->getOpcode() != Opcode::Mul && I->getOpcode() != Opcode::Shl)
+    return std::nullopt;
+  std::optional<AffineExpr> lhs = getAffine(I->getOperand(0));
+  std::optional<AffineExpr> rhs = getAffine(I->getOperand(1));
+  if (!lhs || !rhs)
+    return std::nullopt;
+  switch (I->getOpcode()) {
+  case Opcode::Add:
+  case Opcode::Sub:
+    addScaled(E, *lhs, 1);
+    addScaled(E, *rhs, I->getOpcode() == Opcode::Add ? 1 : -1);
+    return E;
+  case Opcode::Mul:
+    if (lhs->terms.empty())
+      std::swap(lhs, rhs);
+    if (!rhs->terms.empty())
+      return std::nullopt;
+    addScaled(E, *lhs, rhs->constant);
+    return E;
+  default: // Shl
+    if (!rhs->terms.empty() || rhs->constant < 0 || rhs->constant > 30)
+      return std::nullopt;
+    addScaled(E, *lhs, int64_t(1) << rhs->constant);
+    return E;
+  }
+}
+
+ArrayAccess DependenceAnalysis::getAccess(Instruction *I) {
+  ArrayAccess A;
+  A.inst = I;
+  A.isWrite = I->getOpcode() == Opcode::Store;
+  Value *ptr = I->getOperand(A.isWrite ? 1 : 0);
+
+  std::vector<Value *> indices;
+  while (auto *gep = dynamic_cast<Instruction *>(ptr)) {
+    if (gep->getOpcode() != Opcode::GetElemPtr &&
+        gep->getOpcode() != Opcode::GetPtr)
+      break;
+    indices.push_back(gep->getOperand(1));
+    ptr = gep->getOperand(0);
+  }
+  A.base = AA_.getUnderlyingObject(ptr);
+  for (auto it = indices.rbegin(); it != indices.rend(); ++it) {
+    std::optional<AffineExpr> E = getAffine(*it);
+    A.affine &= E.has_value();
+    A.subscripts.push_back(E ? *E : AffineExpr());
+  }
+  return A;
+}
+
+static bool isIdentifiedObject(Value *V) {
+  auto *I = dynamic_cast<Instruction *>(V);
+  return (I && I->getOpcode() == Opcode::Alloc) ||
+         dynamic_cast<GlobalVariable *>(V);
+}
+
+DependenceAnalysis::Result
+DependenceAnalysis::getDistance(const ArrayAccess &A, const ArrayAccess &B,
+                                std::vector<std::optional<int64_t>> &Distance) {
+  const size_t numIVs = ivSlots_.size();
+  Distance.assign(numIVs, std::nullopt);
+  if (A.base != B.base)
+    return isIdentifiedObject(A.base) && isIdentifiedObject(B.base)
+               ? Result::Independent
+               : Result::Unknown;
+  if (!A.affine || !B.affine || A.subscripts.size() != B.subscripts.size())
+    return Result::Unknown;
+
+  // per dimension: sum(coeff[iv] * distance[iv]) = rhs
+  struct Equation {
+    std::vector<int64_t> coeffs;
+    int64_t rhs;
+  };
+  std::vector<Equation> equations;
+  for (size_t d = 0; d < A.subscripts.size(); ++d) {
+    AffineExpr a = A.subscripts[d];
+    AffineExpr b = B.subscripts[d];
+    Equation eq{std::vector<int64_t>(numIVs, 0), a.constant - b.constant};
+    for (size_t k = 0; k < numIVs; ++k) {
+      int64_t ca = a.terms.count(ivSlots_[k]) ? a.terms[ivSlots_[k]] : 0;
+      int64_t cb = b.terms.count(ivSlots_[k]) ? b.terms[ivSlots_[k]] : 0;
+      if (ca != cb)
+        return Result::Unknown;
+      eq.coeffs[k] = ca;
+      a.terms.erase(ivSlots_[k]);
+      b.terms.erase(ivSlots_[k]);
+    }
+    if (a.terms != b.terms)
+      return Result::Unknown;
+    equations.push_back(eq);
+  }
+
+  // solve the equations with a single unknown until nothing changes
+  bool progress = true;
+  while (progress) {
+    progress = false;
+    for (const Equation &eq : equations) {
+      int64_t rest = eq.rhs;
+      int unknown = -1;
+      int numUnknown = 0;
+      for (size_t k = 0; k < numIVs; ++k) {
+        if (!eq.coeffs[k])
+          continue;
+        if (Distance[k]) {
+          rest -= eq.coeffs[k] * *Distance[k];
+        } else {
+          unknown = k;
+          ++numUnknown;
+        }
+      }
+      if (numUnknown == 0) {
+        if (rest != 0)
+          return Result::Independent;
+      } else if (numUnknown == 1) {
+        if (rest % eq.coeffs[unknown] != 0)
+          return Result::Independent;
+        Distance[unknown] = rest / eq.coeffs[unknown];
+        progress = true;
+      }
+    }
+  }
+  return Result::Dependent;
+}
+
+} // namespace nanocc
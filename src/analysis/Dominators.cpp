@@ -0,0 +1,92 @@
+#include "nanocc/analysis/Dominators.h"
+#include "nanocc/ir/BasicBlock.h"
+#include "nanocc/ir/Function.h"
+#include <unordered_set>
+#include <utility>
+
+namespace nanocc {
+
+DominatorTree::DominatorTree(Function &F) {
+  // postorder DFS, successors taken in order
+  std::vector<BasicBlock *> postorder;
+  std::unordered_set<BasicBlock *> visited;
+  std::vector<std::pair<BasicBlock *, std::vector<BasicBlock *>>> stack;
+  auto enter = [&](BasicBlock *BB) {
+    visited.insert(BB);
+    std::vector<BasicBlock *> succs = BB->getSuccessors();
+    stack.emplace_back(BB, std::vector<BasicBlock *>(succs.rbegin(),
+                                                      succs.rend()));
+  };
+  enter(F.getBasicBlockList().front());
+  while (!stack.empty()) {
+    auto &pending = stack.back().second;
+    if (pending.empty()) {
+      postorder.push_back(stack.back().first);
+      stack.pop_back();
+      continue;
+    }
+    BasicBlock *succ = pending.back();
+    pending.pop_back();
+    if (!visited.count(succ))
+      enter(succ);
+  }
+
+  rpo_.assign(postorder.rbegin(), postorder.rend());
+  for (unsigned i = 0; i < rpo_.size(); ++i)
+    rpoIndex_[rpo_[i]] = i;
+
+  const unsigned undefined = ~0u;
+  idom_.assign(rpo_.size(), undefined);
+  idom_[0] = 0;
+
+  auto intersect = [&](unsigned a, unsigned b) {
+    while (a != b) {
+      while (a > b)
+        a = idom_[a];
+      while (b > a)
+        b = idom_[b];
+    }
+    return a;
+  };
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (unsigned i = 1; i < rpo_.size(); ++i) {
+      unsigned newIDom = undefined;
+      for (BasicBlock *pred : rpo_[i]->getPredecessors()) {
+        auto it = rpoIndex_.find(pred);
+        if (it == rpoIndex_.end() || idom_[it->second] == undefined)
+          continue;
+        newIDom = newIDom == undefined ? it->second
+                                       : intersect(it->second, newIDom);
+      }
+      if (newIDom != idom_[i]) {
+        idom_[i] = newIDom;
+        changed = true;
+      }
+    }
+  }
+}
+
+BasicBlock *DominatorTree::getIDom(BasicBlock *BB) const {
+  auto it = rpoIndex_.find(BB);
+  if (it == rpoIndex_.end() || it->second == 0)
+    return nullptr;
+  return rpo_[idom_[it->second]];
+}
+
+bool DominatorTree::dominates(BasicBlock *A, BasicBlock *B) const {
+  auto itA = rpoIndex_.find(A);
+  auto itB = rpoIndex_.find(B);
+  if (itA == rpoIndex_.end() || itB == rpoIndex_.end())
+    return false;
+  unsigned a = itA->second;
+  unsigned b = itB->second;
+  // dominators have smaller RPO numbers, walk up from B
+  while (b > a)
+    b = idom_[b];
+  return a == b;
+}
+
+} // namespace nanocc
@@ -0,0 +1,168 @@
+#include "nanocc/analysis/LoopInfo.h"
+#include "nanocc/analysis/Dominators.h"
+#include "nanocc/ir/BasicBlock.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/Instruction.h"
+#include <algorithm>
+#include <functional>
+
+namespace nanocc {
+
+//===--------------------------------------------------------------------===//
+// Loop
+//
+
+bool Loop::contains(const Loop *L) const {
+  for (; L; L = L->parent_)
+    if (L == this)
+      return true;
+  return false;
+}
+
+unsigned Loop::getLoopDepth() const {
+  unsigned depth = 1;
+  for (Loop *L = parent_; L; L = L->parent_)
+    ++depth;
+  return depth;
+}
+
+std::vector<BasicBlock *> Loop::getLatches() const {
+  std::vector<BasicBlock *> latches;
+  for (BasicBlock *pred : getHeader()->getPredecessors())
+    if (contains(pred))
+      latches.push_back(pred);
+  return latches;
+}
+
+BasicBlock *Loop::getLoopLatch() const {
+  std::vector<BasicBlock *> latches = getLatches();
+  return latches.size() == 1 ? latches[0] : nullptr;
+}
+
+BasicBlock *Loop::getLoopPreheader() const {
+  BasicBlock *preheader = nullptr;
+  for (BasicBlock *pred : getHeader()->getPredecessors()) {
+    if (contains(pred))
+      continue;
+    if (preheader)
+      return nullptr;
+    preheader = pred;
+  }
+  if (!preheader || preheader->getSuccessors().size() != 1)
+    return nullptr;
+  return preheader;
+}
+
+std::vector<BasicBlock *> Loop::getExitingBlocks() const {
+  std::vector<BasicBlock *> exiting;
+  for (BasicBlock *BB : blocks_) {
+    for (BasicBlock *succ : BB->getSuccessors()) {
+      if (!contains(succ)) {
+        exiting.push_back(BB);
+        break;
+      }
+    }
+  }
+  return exiting;
+}
+
+std::vector<BasicBlock *> Loop::getExitBlocks() const {
+  std::vector<BasicBlock *> exits;
+  for (BasicBlock *BB : blocks_)
+    for (BasicBlock *succ : BB->getSuccessors())
+      if (!contains(succ) &&
+          std::find(exits.begin(), exits.end(), succ) == exits.end())
+        exits.push_back(succ);
+  return exits;
+}
+
+BasicBlock *Loop::getExitBlock() const {
+  std::vector<BasicBlock *> exits = getExitBlocks();
+  return exits.size() == 1 ? exits[0] : nullptr;
+}
+
+bool Loop::isLoopInvariant(Value *V) const {
+  auto *I = dynamic_cast<Instruction *>(V);
+  return !I || !contains(I->getParent());
+}
+
+//===--------------------------------------------------------------------===//
+// LoopInfo
+//
+
+LoopInfo::LoopInfo(Function &F, const DominatorTree &DT) {
+  std::unordered_map<const BasicBlock *, unsigned> order;
+  for (BasicBlock *BB : F.getBasicBlockList())
+    order.emplace(BB, order.size());
+
+  // discover one loop per header, blocks are collected backwards from the
+  // latches until the header is reached
+  for (BasicBlock *header : DT.getReversePostOrder()) {
+    std::vector<BasicBlock *> worklist;
+    for (BasicBlock *pred : header->getPredecessors())
+      if (DT.dominates(header, pred))
+        worklist.push_back(pred);
+    if (worklist.empty())
+      continue;
+
+    auto L = std::make_unique<Loop>();
+    L->blocks_.push_back(header);
+    L->blockSet_.insert(header);
+    while (!worklist.empty()) {
+      BasicBlock *BB = worklist.back();
+      worklist.pop_back();
+      if (!DT.isReachable(BB) || !L->blockSet_.insert(BB).second)
+        continue;
+      L->blocks_.push_back(BB);
+      for (BasicBlock *pred : BB->getPredecessors())
+        worklist.push_back(pred);
+    }
+    // keep the blocks in layout order after the header
+    std::sort(L->blocks_.begin() + 1, L->blocks_.end(),
+              [&](BasicBlock *A, BasicBlock *B) {
+                return order[A] < order[B];
+              });
+    loops_.push_back(std::move(L));
+  }
+
+  // the parent of a loop is the smallest other loop containing its header
+  std::vector<Loop *> bySize;
+  for (auto &L : loops_)
+    bySize.push_back(L.get());
+  std::stable_sort(bySize.begin(), bySize.end(), [](Loop *A, Loop *B) {
+    return A->blocks_.size() < B->blocks_.size();
+  });
+  for (size_t i = 0; i < bySize.size(); ++i) {
+    Loop *L = bySize[i];
+    for (size_t j = i + 1; j < bySize.size(); ++j) {
+      if (bySize[j]->contains(L->getHeader())) {
+        L->parent_ = bySize[j];
+        bySize[j]->subLoops_.push_back(L);
+        break;
+      }
+    }
+    if (!L->parent_)
+      topLevel_.push_back(L);
+    for (BasicBlock *BB : L->blocks_)
+      innermost_.emplace(BB, L); // smaller loops were inserted first
+  }
+}
+
+Loop *LoopInfo::getLoopFor(const BasicBlock *BB) const {
+  auto it = innermost_.find(BB);
+  return it == innermost_.end() ? nullptr : it->second;
+}
+
+std::vector<Loop *> LoopInfo::getLoopsInPostorder() const {
+  std::vector<Loop *> result;
+  std::function<void(Loop *)> visit = [&](Loop *L) {
+    for (Loop *sub : L->subLoops_)
+      visit(sub);
+    result.push_back(L);
+  };
+  for (Loop *L : topLevel_)
+    visit(L);
+  return result;
+}
+
+} // namespace nanocc
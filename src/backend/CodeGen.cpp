@@ -3,8 +3,12 @@
 #include <cstddef>
 #include <cstdint>
 #include <iostream>
+#include <string>
 
 #include "nanocc/backend/CodeGen.h"
+#include "nanocc/backend/DivMagic.h"
+#include "nanocc/ir/GlobalVariable.h"
+#include "nanocc/ir/Module.h"
 
 #include "koopa.h"
 
@@ -62,14 +66,36 @@ void ProgramCodeGen::EmitGlobalAlloc(const koopa_raw_value_t &value) {
   EmitInitializer(value->kind.data.global_alloc.init);
 }
 
+void ProgramCodeGen::SetReadOnlyGlobals(const nanocc::Module &module) {
+  read_only_globals_.clear();
+  for (nanocc::GlobalVariable *GV :
+       const_cast<nanocc::Module &>(module).getGlobalList())
+    if (GV->isConstant())
+      read_only_globals_.insert(GV->getName());
+}
+
 void ProgramCodeGen::EmitDataSection(const koopa_raw_slice_t &values) {
   if (values.len == 0)
     return;
 
-  std::cout << "  .data" << std::endl;
-  for (size_t i = 0; i < values.len; ++i) {
-    auto val = reinterpret_cast<koopa_raw_value_t>(values.buffer[i]);
-    EmitGlobalAlloc(val);
+  // 只读的全局变量单独放入 .rodata
+  auto is_read_only = [&](koopa_raw_value_t val) {
+    std::string name = val->name;
+    return read_only_globals_.count(name.substr(1)) > 0;
+  };
+  for (bool read_only : {false, true}) {
+    bool header_emitted = false;
+    for (size_t i = 0; i < values.len; ++i) {
+      auto val = reinterpret_cast<koopa_raw_value_t>(values.buffer[i]);
+      if (is_read_only(val) != read_only)
+        continue;
+      if (!header_emitted) {
+        std::cout << (read_only ? "  .section .rodata" : "  .data")
+                  << std::endl;
+        header_emitted = true;
+      }
+      EmitGlobalAlloc(val);
+    }
   }
   std::cout << std::endl;
 }
@@ -82,7 +108,7 @@ void ProgramCodeGen::Emit(const koopa_raw_program_t &program) {
   for (size_t i = 0; i < funcs.len; ++i) {
     koopa_raw_function_t func =
         reinterpret_cast<koopa_raw_function_t>(funcs.buffer[i]);
-    FunctionCodeGen func_gen;
+    FunctionCodeGen func_gen(zicond_);
     func_gen.EmitFunction(func);
   }
 }
@@ -134,6 +160,9 @@ void FunctionCodeGen::EmitSlice(const koopa_raw_slice_t &slice) {
       EmitFunction(reinterpret_cast<koopa_raw_function_t>(ptr));
       break;
     case KOOPA_RSIK_BASIC_BLOCK:
+      next_bb_ = i + 1 < slice.len ? reinterpret_cast<koopa_raw_basic_block_t>(
+                                         slice.buffer[i + 1])
+                                   : nullptr;
       EmitBasicBlock(reinterpret_cast<koopa_raw_basic_block_t>(ptr));
       break;
     case KOOPA_RSIK_VALUE:
@@ -190,6 +219,83 @@ void FunctionCodeGen::EmitBasicBlock(const koopa_raw_basic_block_t &bb) {
   EmitSlice(bb->insts);
 }
 
+namespace {
+
+/// IRSerializer 为 select 生成的掩码序列 f ^ ((t ^ f) & (0 - m))
+struct SelectParts {
+  koopa_raw_value_t cond, true_val, false_val;
+  koopa_raw_value_t diff, mask, bits;
+};
+
+} // namespace
+
+static bool IsBinary(koopa_raw_value_t val, koopa_raw_binary_op_t op) {
+  return val->kind.tag == KOOPA_RVT_BINARY && val->kind.data.binary.op == op;
+}
+
+static bool IsIntegerValue(koopa_raw_value_t val, int32_t v) {
+  return val->kind.tag == KOOPA_RVT_INTEGER &&
+         val->kind.data.integer.value == v;
+}
+
+/// 同一个值, 或者相等的整数常量
+static bool IsSameValue(koopa_raw_value_t a, koopa_raw_value_t b) {
+  return a == b || (b->kind.tag == KOOPA_RVT_INTEGER &&
+                    IsIntegerValue(a, b->kind.data.integer.value));
+}
+
+static bool IsComparison(koopa_raw_value_t val) {
+  if (val->kind.tag != KOOPA_RVT_BINARY)
+    return false;
+  switch (val->kind.data.binary.op) {
+  case KOOPA_RBO_NOT_EQ:
+  case KOOPA_RBO_EQ:
+  case KOOPA_RBO_GT:
+  case KOOPA_RBO_LT:
+  case KOOPA_RBO_GE:
+  case KOOPA_RBO_LE:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/// m 是比较结果 (0 或 1), 中间值都只被这个序列使用
+static bool MatchSelect(koopa_raw_value_t value, SelectParts &parts) {
+  if (!IsBinary(value, KOOPA_RBO_XOR))
+    return false;
+  parts.false_val = value->kind.data.binary.lhs;
+  parts.bits = value->kind.data.binary.rhs;
+  if (!IsBinary(parts.bits, KOOPA_RBO_AND) || parts.bits->used_by.len != 1)
+    return false;
+  parts.diff = parts.bits->kind.data.binary.lhs;
+  parts.mask = parts.bits->kind.data.binary.rhs;
+  if (!IsBinary(parts.diff, KOOPA_RBO_XOR) || parts.diff->used_by.len != 1 ||
+      !IsSameValue(parts.diff->kind.data.binary.rhs, parts.false_val) ||
+      !IsBinary(parts.mask, KOOPA_RBO_SUB) || parts.mask->used_by.len != 1 ||
+      !IsIntegerValue(parts.mask->kind.data.binary.lhs, 0))
+    return false;
+  parts.true_val = parts.diff->kind.data.binary.lhs;
+  parts.cond = parts.mask->kind.data.binary.rhs;
+  return IsComparison(parts.cond);
+}
+
+/// 值是某个 select 序列的中间值, 不单独生成代码
+static bool IsSelectPart(koopa_raw_value_t value) {
+  if (value->kind.tag != KOOPA_RVT_BINARY || value->used_by.len != 1)
+    return false;
+  auto user = reinterpret_cast<koopa_raw_value_t>(value->used_by.buffer[0]);
+  SelectParts parts;
+  if (MatchSelect(user, parts))
+    return value == parts.bits;
+  // diff 和 mask 的使用者是 bits
+  return user->used_by.len == 1 &&
+         MatchSelect(
+             reinterpret_cast<koopa_raw_value_t>(user->used_by.buffer[0]),
+             parts) &&
+         user == parts.bits;
+}
+
 void FunctionCodeGen::EmitValue(const koopa_raw_value_t &value) {
   const auto &kind = value->kind;
   switch (kind.tag) {
@@ -208,11 +314,32 @@ void FunctionCodeGen::EmitValue(const koopa_raw_value_t &value) {
     break;
   case KOOPA_RVT_BINARY: {
     const auto &binary = kind.data.binary;
+
+    // select 的中间值在 select 处一并计算
+    if (IsSelectPart(value))
+      break;
     size_t res_offset = GetStackOffset(value);
 
+    SelectParts sel;
+    if (MatchSelect(value, sel)) {
+      EmitSelect(sel.cond, sel.true_val, sel.false_val);
+      SafeStore("t0", res_offset);
+      break;
+    }
+
     // 加载左操作数到 t0
     LoadReg("t0", binary.lhs);
 
+    // 除数为非零常数时, 用乘法和移位代替 div/rem
+    if ((binary.op == KOOPA_RBO_DIV || binary.op == KOOPA_RBO_MOD) &&
+        binary.rhs->kind.tag == KOOPA_RVT_INTEGER &&
+        binary.rhs->kind.data.integer.value != 0) {
+      EmitDivRemByConst(binary.op == KOOPA_RBO_MOD,
+                        binary.rhs->kind.data.integer.value);
+      SafeStore("t0", res_offset);
+      break;
+    }
+
     // 加载右操作数到 t1
     LoadReg("t1", binary.rhs);
 
@@ -309,6 +436,18 @@ void FunctionCodeGen::EmitValue(const koopa_raw_value_t &value) {
     // 加载条件
     LoadReg("t0", branch.cond);
 
+    // 没有块参数时直接跳到目标块, 紧跟在后面的目标块不需要跳转
+    if (branch.true_args.len == 0 && branch.false_args.len == 0) {
+      if (branch.false_bb == next_bb_) {
+        std::cout << "  bnez t0, " << true_label << std::endl;
+      } else {
+        std::cout << "  beqz t0, " << false_label << std::endl;
+        if (branch.true_bb != next_bb_)
+          std::cout << "  j " << true_label << std::endl;
+      }
+      break;
+    }
+
     // 条件为 false 时跳到 false 分支
     std::cout << "  beqz t0, " << false_label << "_args" << std::endl;
 
@@ -326,7 +465,8 @@ void FunctionCodeGen::EmitValue(const koopa_raw_value_t &value) {
     const auto &jump = kind.data.jump;
     std::string jump_label = std::string(jump.target->name).substr(1);
     EmitBlockArgs(jump.target, jump.args);
-    std::cout << "  j " << jump_label << std::endl;
+    if (jump.target != next_bb_)
+      std::cout << "  j " << jump_label << std::endl;
     break;
   }
 
@@ -453,6 +593,41 @@ void FunctionCodeGen::EmitValue(const koopa_raw_value_t &value) {
   std::cout << std::endl;
 }
 
+/**
+  * select: cond 非零时取 true_val, 否则取 false_val, 结果放在 t0
+  有 Zicond 时用 czero 清掉没选中的一侧再合并, 否则用掩码
+  f ^ ((t ^ f) & -cond), 都不需要跳转
+*/
+void FunctionCodeGen::EmitSelect(koopa_raw_value_t cond,
+                                 koopa_raw_value_t true_val,
+                                 koopa_raw_value_t false_val) {
+  LoadReg("t0", true_val);
+  LoadReg("t1", false_val);
+  LoadReg("t2", cond);
+  if (zicond_) {
+    std::cout << "  czero.eqz t0, t0, t2" << std::endl;
+    std::cout << "  czero.nez t1, t1, t2" << std::endl;
+    std::cout << "  or t0, t0, t1" << std::endl;
+  } else {
+    std::cout << "  xor t0, t0, t1" << std::endl;
+    std::cout << "  sub t2, zero, t2" << std::endl;
+    std::cout << "  and t0, t0, t2" << std::endl;
+    std::cout << "  xor t0, t0, t1" << std::endl;
+  }
+}
+
+/**
+  * 有符号除以常数 (t0 / divisor 或 t0 % divisor), 结果放在 t0
+  1. |d| == 1: 取反或直接得到结果
+  2. |d| == 2^k: 负数先加上 2^k - 1 再算术右移
+  3. 其他: mulh 取乘积高位, 再移位并修正负数的商
+  余数由 n - q * d 得到, 指令序列由 ExpandDivRemByConst 生成
+*/
+void FunctionCodeGen::EmitDivRemByConst(bool is_rem, int32_t divisor) {
+  for (const DivRemInst &inst : ExpandDivRemByConst(is_rem, divisor))
+    std::cout << "  " << FormatDivRemInst(inst) << std::endl;
+}
+
 /**
   * 分配栈帧空间
   1. ra 寄存器
@@ -498,7 +673,7 @@ void FunctionCodeGen::AllocateStackSpace() {
     koopa_raw_slice_t insts = bb->insts;
     for (size_t j = 0; j < insts.len; ++j) {
       koopa_raw_value_t inst = (koopa_raw_value_t)insts.buffer[j];
-      if (inst->ty->tag != KOOPA_RTT_UNIT) {
+      if (inst->ty->tag != KOOPA_RTT_UNIT && !IsSelectPart(inst)) {
         if (inst->kind.tag == KOOPA_RVT_ALLOC) {
           // Alloc 指令不仅返回指针，还要在栈上分配它所指向类型的大小
           size_t size =
@@ -0,0 +1,127 @@
+#include "nanocc/backend/DivMagic.h"
+
+#include <cassert>
+#include <string>
+#include <vector>
+
+SignedDivMagic ComputeSignedDivMagic(int32_t d) {
+  assert(d != 0 && d != 1 && d != -1);
+  const uint32_t two31 = 0x80000000u;
+
+  uint32_t ud = static_cast<uint32_t>(d);
+  uint32_t ad = d < 0 ? 0u - ud : ud;
+  uint32_t t = two31 + (ud >> 31);
+  uint32_t anc = t - 1 - t % ad; // |nc|
+  int p = 31;
+  uint32_t q1 = two31 / anc, r1 = two31 - q1 * anc;
+  uint32_t q2 = two31 / ad, r2 = two31 - q2 * ad;
+  uint32_t delta;
+  do {
+    ++p;
+    q1 *= 2;
+    r1 *= 2;
+    if (r1 >= anc) {
+      ++q1;
+      r1 -= anc;
+    }
+    q2 *= 2;
+    r2 *= 2;
+    if (r2 >= ad) {
+      ++q2;
+      r2 -= ad;
+    }
+    delta = ad - r2;
+  } while (q1 < delta || (q1 == delta && r1 == 0));
+
+  uint32_t m = q2 + 1;
+  if (d < 0)
+    m = 0u - m;
+  return {static_cast<int32_t>(m), p - 32};
+}
+
+std::vector<DivRemInst> ExpandDivRemByConst(bool is_rem, int32_t divisor) {
+  assert(divisor != 0);
+  using I = DivRemInst;
+  std::vector<DivRemInst> insts;
+  uint32_t abs_d = divisor < 0 ? 0u - static_cast<uint32_t>(divisor)
+                               : static_cast<uint32_t>(divisor);
+
+  if (abs_d == 1) {
+    if (is_rem)
+      insts.push_back({I::Li, I::T0});
+    else if (divisor < 0)
+      insts.push_back({I::Sub, I::T0, I::Zero, I::T0});
+    return insts;
+  }
+
+  if ((abs_d & (abs_d - 1)) == 0) {
+    int k = 0;
+    while ((1u << k) != abs_d)
+      ++k;
+
+    // t1 = n + (n < 0 ? 2^k - 1 : 0)
+    if (k == 1) {
+      insts.push_back({I::Srli, I::T1, I::T0, I::Zero, 31});
+    } else {
+      insts.push_back({I::Srai, I::T1, I::T0, I::Zero, 31});
+      insts.push_back({I::Srli, I::T1, I::T1, I::Zero, 32 - k});
+    }
+    insts.push_back({I::Add, I::T1, I::T0, I::T1});
+
+    if (is_rem) {
+      // n - (t1 & -2^k): the remainder takes the sign of the dividend,
+      // whatever the sign of the divisor
+      insts.push_back(
+          {I::Li, I::T2, I::Zero, I::Zero, static_cast<int32_t>(0u - abs_d)});
+      insts.push_back({I::And, I::T1, I::T1, I::T2});
+      insts.push_back({I::Sub, I::T0, I::T0, I::T1});
+    } else {
+      insts.push_back({I::Srai, I::T0, I::T1, I::Zero, k});
+      if (divisor < 0)
+        insts.push_back({I::Sub, I::T0, I::Zero, I::T0});
+    }
+    return insts;
+  }
+
+  SignedDivMagic magic = ComputeSignedDivMagic(divisor);
+  insts.push_back({I::Li, I::T1, I::Zero, I::Zero, magic.multiplier});
+  insts.push_back({I::Mulh, I::T1, I::T0, I::T1});
+  if (divisor > 0 && magic.multiplier < 0)
+    insts.push_back({I::Add, I::T1, I::T1, I::T0});
+  if (divisor < 0 && magic.multiplier > 0)
+    insts.push_back({I::Sub, I::T1, I::T1, I::T0});
+  if (magic.shift > 0)
+    insts.push_back({I::Srai, I::T1, I::T1, I::Zero, magic.shift});
+  // add one to a negative quotient, rounding towards zero
+  insts.push_back({I::Srli, I::T2, I::T1, I::Zero, 31});
+  insts.push_back({I::Add, I::T1, I::T1, I::T2});
+
+  if (is_rem) {
+    // n - q * d
+    insts.push_back({I::Li, I::T2, I::Zero, I::Zero, divisor});
+    insts.push_back({I::Mul, I::T1, I::T1, I::T2});
+    insts.push_back({I::Sub, I::T0, I::T0, I::T1});
+  } else {
+    insts.push_back({I::Mv, I::T0, I::T1});
+  }
+  return insts;
+}
+
+std::string FormatDivRemInst(const DivRemInst &inst) {
+  static const char *const opNames[] = {"li",  "mv",  "add",  "sub", "and",
+                                        "mul", "mulh", "srai", "srli"};
+  static const char *const regNames[] = {"zero", "t0", "t1", "t2"};
+
+  std::string text = std::string(opNames[inst.op]) + " " + regNames[inst.rd];
+  switch (inst.op) {
+  case DivRemInst::Li:
+    return text + ", " + std::to_string(inst.imm);
+  case DivRemInst::Mv:
+    return text + ", " + regNames[inst.rs1];
+  case DivRemInst::Srai:
+  case DivRemInst::Srli:
+    return text + ", " + regNames[inst.rs1] + ", " + std::to_string(inst.imm);
+  default:
+    return text + ", " + regNames[inst.rs1] + ", " + regNames[inst.rs2];
+  }
+}
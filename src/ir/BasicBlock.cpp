@@ -1,5 +1,7 @@
 #include "nanocc/ir/BasicBlock.h"
 #include "nanocc/ir/Function.h"
+#include <algorithm>
+#include <cassert>
 
 namespace nanocc {
 
@@ -11,4 +13,36 @@ BasicBlock *BasicBlock::create(Function &parent, const std::string &name) {
   return new BasicBlock(parent, name);
 }
 
+std::vector<BasicBlock *> BasicBlock::getSuccessors() {
+  std::vector<BasicBlock *> succs;
+  Instruction *term = getTerminator();
+  if (!term)
+    return succs;
+  for (unsigned i = 0; i < term->getNumOperands(); ++i) {
+    auto *succ = dynamic_cast<BasicBlock *>(term->getOperand(i));
+    if (succ && std::find(succs.begin(), succs.end(), succ) == succs.end())
+      succs.push_back(succ);
+  }
+  return succs;
+}
+
+std::vector<BasicBlock *> BasicBlock::getPredecessors() {
+  std::vector<BasicBlock *> preds;
+  for (Use *U = use_begin(); U != use_end(); U = U->getNext()) {
+    auto *term = static_cast<Instruction *>(U->getUser());
+    BasicBlock *pred = term->getParent();
+    if (std::find(preds.begin(), preds.end(), pred) == preds.end())
+      preds.push_back(pred);
+  }
+  return preds;
+}
+
+void BasicBlock::eraseFromParent() {
+  assert(use_empty() && "Erasing a basic block that is still a branch target");
+  for (auto &I : instList_)
+    I->dropAllReferences();
+  getParent()->getBasicBlockList().remove(this);
+  delete this;
+}
+
 } // namespace nanocc
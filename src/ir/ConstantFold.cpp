@@ -0,0 +1,79 @@
+#include "nanocc/ir/ConstantFold.h"
+#include "nanocc/ir/Constant.h"
+#include "nanocc/ir/Type.h"
+#include <cstdint>
+
+namespace nanocc {
+
+ConstantInt *ConstantFoldBinaryOp(Instruction::Opcode op, const ConstantInt *L,
+                                  const ConstantInt *R) {
+  int32_t lval = L->getValue();
+  int32_t rval = R->getValue();
+  // unsigned views avoid UB on overflow
+  uint32_t ul = static_cast<uint32_t>(lval);
+  uint32_t ur = static_cast<uint32_t>(rval);
+  int32_t res = 0;
+  switch (op) {
+  case Instruction::Opcode::Add:
+    res = static_cast<int32_t>(ul + ur);
+    break;
+  case Instruction::Opcode::Sub:
+    res = static_cast<int32_t>(ul - ur);
+    break;
+  case Instruction::Opcode::Mul:
+    res = static_cast<int32_t>(ul * ur);
+    break;
+  case Instruction::Opcode::Div:
+    if (rval == 0)
+      res = 0;
+    else if (rval == -1)
+      res = static_cast<int32_t>(0u - ul);
+    else
+      res = lval / rval;
+    break;
+  case Instruction::Opcode::Mod:
+    res = (rval == 0 || rval == -1) ? 0 : lval % rval;
+    break;
+  case Instruction::Opcode::Lt:
+    res = lval < rval;
+    break;
+  case Instruction::Opcode::Le:
+    res = lval <= rval;
+    break;
+  case Instruction::Opcode::Gt:
+    res = lval > rval;
+    break;
+  case Instruction::Opcode::Ge:
+    res = lval >= rval;
+    break;
+  case Instruction::Opcode::Eq:
+    res = lval == rval;
+    break;
+  case Instruction::Opcode::Ne:
+    res = lval != rval;
+    break;
+  case Instruction::Opcode::And:
+    res = static_cast<int32_t>(ul & ur);
+    break;
+  case Instruction::Opcode::Or:
+    res = static_cast<int32_t>(ul | ur);
+    break;
+  case Instruction::Opcode::Xor:
+    res = static_cast<int32_t>(ul ^ ur);
+    break;
+  case Instruction::Opcode::Shl:
+    res = static_cast<int32_t>(ul << (ur & 31));
+    break;
+  case Instruction::Opcode::Shr:
+    res = static_cast<int32_t>(ul >> (ur & 31));
+    break;
+  case Instruction::Opcode::Sar:
+    res = lval >> (ur & 31);
+    break;
+  default:
+    return nullptr;
+  }
+  return ConstantInt::get(Type::getInt32Ty(), res);
+}
+
+} // namespace nanocc
@@ -1,5 +1,6 @@
 #include "nanocc/ir/Function.h"
 #include "nanocc/ir/Module.h"
+#include <cassert>
 
 namespace nanocc {
 
@@ -34,6 +35,23 @@ Function *Function::create(FunctionType *T, LinkageTypes linkage,
   return F;
 }
 
+void Function::eraseArgument(unsigned ArgNo) {
+  assert(arguments_[ArgNo]->use_empty() && "Erasing an argument in use");
+  delete arguments_[ArgNo];
+  arguments_.erase(arguments_.begin() + ArgNo);
+  for (unsigned i = ArgNo; i < arguments_.size(); ++i)
+    arguments_[i]->setArgNo(i);
+
+  std::vector<Type *> params;
+  for (Argument *arg : arguments_)
+    params.push_back(arg->getType());
+  vTy_ = FunctionType::get(getType()->getFunctionReturnType(), params);
+}
+
+void Function::setReturnType(Type *RetTy) {
+  vTy_ = FunctionType::get(RetTy, getType()->getFunctionParamTypes());
+}
+
 std::string Function::getUniqueName(const std::string &name) {
   if (name.empty())
     return "";
@@ -48,6 +66,8 @@ std::string Function::getUniqueName(const std::string &name) {
     while (nameCounts_.count(newName)) {
       newName = baseName + std::to_string(nameCounts_[baseName]++);
     }
+    // a later request for this exact name must not get it again
+    nameCounts_[newName] = 1;
     return newName;
   }
 }
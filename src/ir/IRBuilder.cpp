@@ -1,5 +1,6 @@
 #include "nanocc/ir/IRBuilder.h"
 #include "nanocc/ir/Constant.h"
+#include "nanocc/ir/ConstantFold.h"
 #include "nanocc/ir/Instruction.h"
 #include "nanocc/ir/Type.h"
 #include "nanocc/ir/Value.h"
@@ -8,51 +9,25 @@
 
 namespace nanocc {
 
+void IRBuilder::setInsertPoint(Instruction *I) {
+  BB_ = I->getParent();
+  auto &instList = BB_->getInstList();
+  for (auto it = instList.begin(); it != instList.end(); ++it) {
+    if (it->get() == I) {
+      insertPt_ = it;
+      return;
+    }
+  }
+  assert(false && "Instruction not found in its parent block");
+}
+
 Value *IRBuilder::createBinaryOp(Instruction::Opcode op, Value *lhs,
                                  Value *rhs) {
   if (auto *L = dynamic_cast<ConstantInt *>(lhs)) {
     if (auto *R = dynamic_cast<ConstantInt *>(rhs)) {
-      int lval = L->getValue();
-      int rval = R->getValue();
-      int res = 0;
-      switch (op) {
-      case Instruction::Opcode::Add:
-        res = lval + rval;
-        break;
-      case Instruction::Opcode::Sub:
-        res = lval - rval;
-        break;
-      case Instruction::Opcode::Mul:
-        res = lval * rval;
-        break;
-      case Instruction::Opcode::Div:
-        res = (rval == 0) ? 0 : lval / rval;
-        break;
-      case Instruction::Opcode::Mod:
-        res = (rval == 0) ? 0 : lval % rval;
-        break;
-      case Instruction::Opcode::Lt:
-        res = lval < rval;
-        break;
-      case Instruction::Opcode::Le:
-        res = lval <= rval;
-        break;
-      case Instruction::Opcode::Gt:
-        res = lval > rval;
-        break;
-      case Instruction::Opcode::Ge:
-        res = lval >= rval;
-        break;
-      case Instruction::Opcode::Eq:
-        res = lval == rval;
-        break;
-      case Instruction::Opcode::Ne:
-        res = lval != rval;
-        break;
-      default:
-        assert(false && "Unknown Opcode");
-      }
-      return ConstantInt::get(Type::getInt32Ty(), res);
+      ConstantInt *res = ConstantFoldBinaryOp(op, L, R);
+      assert(res && "Unknown Opcode");
+      return res;
     }
   }
 
@@ -68,6 +43,22 @@ Value *IRBuilder::createBinaryOp(Instruction::Opcode op, Value *lhs,
   return insert(std::move(inst));
 }
 
+Value *IRBuilder::createSelect(Value *cond, Value *true_val,
+                               Value *false_val) {
+  if (auto *C = dynamic_cast<ConstantInt *>(cond))
+    return C->getValue() ? true_val : false_val;
+  if (true_val == false_val)
+    return true_val;
+
+  assert(BB_ && "BasicBlock is null when creating instruction!");
+  auto inst = Instruction::create(true_val->getType(),
+                                  Instruction::Opcode::Select, 3, BB_);
+  inst->setOperand(0, cond);
+  inst->setOperand(1, true_val);
+  inst->setOperand(2, false_val);
+  return insert(std::move(inst));
+}
+
 Instruction *IRBuilder::createAlloca(Type *type, const std::string &var_name) {
   Type *ptrTy = Type::getPointerTy(type);
 
@@ -16,6 +16,13 @@
 
 namespace nanocc {
 
+/// Local array initializers with at least this many zero elements clear the
+/// array with a loop and store only the non-zero elements.
+static constexpr int ZeroFillThreshold = 16;
+
+/// Elements cleared per iteration of the zero-fill loop
+static constexpr int ZeroFillUnroll = 4;
+
 IRGenVisitor::IRGenVisitor(Module &module)
     : module_(module), builder_(new IRBuilder()),
       nameValues_(new ValueSymbolTable()) {
@@ -433,7 +440,7 @@ void IRGenVisitor::visitConstDef_(const ConstDefAST *ast) {
       }
     }
     GlobalVariable *GV = GlobalVariable::create(finalType, ast->ident, &module_,
-                                                initializer, false);
+                                                initializer, true);
     // insert global variable into symbol table
     nameValues_->insert(ast->ident, GV);
   } else {
@@ -455,7 +462,6 @@ void IRGenVisitor::visitConstDef_(const ConstDefAST *ast) {
 }
 
 void IRGenVisitor::visitIfStmt_(const IfStmtAST *ast) {
-  Value *cond = evalRVal(ast->exp.get());
   Function *func = builder_->getInsertBlock()->getParent();
   BasicBlock *thenBB = BasicBlock::create(*func, "then");
   BasicBlock *elseBB = nullptr;
@@ -464,9 +470,9 @@ void IRGenVisitor::visitIfStmt_(const IfStmtAST *ast) {
   BasicBlock *mergeBB = BasicBlock::create(*func, "if_end");
 
   if (ast->else_stmt) {
-    builder_->createCondBr(cond, thenBB, elseBB);
+    emitCondBr(ast->exp.get(), thenBB, elseBB);
   } else {
-    builder_->createCondBr(cond, thenBB, mergeBB);
+    emitCondBr(ast->exp.get(), thenBB, mergeBB);
   }
 
   // Then
@@ -519,8 +525,7 @@ void IRGenVisitor::visitWhileStmt_(const WhileStmtAST *ast) {
   // Condition
   func->addBasicBlock(condBB);
   builder_->setInsertPoint(condBB);
-  Value *cond = evalRVal(ast->cond.get());
-  builder_->createCondBr(cond, bodyBB, endBB);
+  emitCondBr(ast->cond.get(), bodyBB, endBB);
 
   // Body
   func->addBasicBlock(bodyBB);
@@ -561,10 +566,13 @@ void IRGenVisitor::visitContinueStmt_(const ContinueStmtAST *ast) {
 // Lib functions
 void IRGenVisitor::registerLibFunctions() {
   auto addLibFunc = [&](const std::string &name, Type *retType,
-                        const std::initializer_list<Type *> paramTypes) {
+                        const std::initializer_list<Type *> paramTypes,
+                        ModRefInfo argEffect = NoModRef) {
     FunctionType *FT = FunctionType::get(retType, paramTypes);
     Function *F =
         Function::create(FT, Function::ExternalLinkage, name, module_);
+    // program memory is only reached through array arguments
+    F->setMemoryEffects({NoModRef, argEffect, true});
     nameValues_->insert(name, F);
   };
 
@@ -574,10 +582,10 @@ void IRGenVisitor::registerLibFunctions() {
 
   addLibFunc("getint", i32, {});
   addLibFunc("getch", i32, {});
-  addLibFunc("getarray", i32, {ptrI32});
+  addLibFunc("getarray", i32, {ptrI32}, Mod);
   addLibFunc("putint", voidTy, {i32});
   addLibFunc("putch", voidTy, {i32});
-  addLibFunc("putarray", voidTy, {i32, ptrI32});
+  addLibFunc("putarray", voidTy, {i32, ptrI32}, Ref);
   addLibFunc("starttime", voidTy, {});
   addLibFunc("stoptime", voidTy, {});
 }
@@ -646,6 +654,47 @@ Value *IRGenVisitor::evalLogicalOr(BinaryExpAST *ast, Value *lhsVal) {
   return builder_->createLoad(result);
 }
 
+void IRGenVisitor::emitCondBr(BaseAST *ast, BasicBlock *trueBB,
+                              BasicBlock *falseBB) {
+  Function *func = builder_->getInsertBlock()->getParent();
+
+  if (auto *bin = dynamic_cast<BinaryExpAST *>(ast)) {
+    // a && b: a false -> falseBB, else test b
+    if (bin->op == "&&") {
+      BasicBlock *rhsBB = BasicBlock::create(*func, "and_rhs");
+      emitCondBr(bin->lhs.get(), rhsBB, falseBB);
+      func->addBasicBlock(rhsBB);
+      builder_->setInsertPoint(rhsBB);
+      emitCondBr(bin->rhs.get(), trueBB, falseBB);
+      return;
+    }
+    // a || b: a true -> trueBB, else test b
+    if (bin->op == "||") {
+      BasicBlock *rhsBB = BasicBlock::create(*func, "or_rhs");
+      emitCondBr(bin->lhs.get(), trueBB, rhsBB);
+      func->addBasicBlock(rhsBB);
+      builder_->setInsertPoint(rhsBB);
+      emitCondBr(bin->rhs.get(), trueBB, falseBB);
+      return;
+    }
+  }
+
+  // !a: swap the targets
+  if (auto *unary = dynamic_cast<UnaryExpAST *>(ast)) {
+    if (unary->op == "!") {
+      emitCondBr(unary->exp.get(), falseBB, trueBB);
+      return;
+    }
+  }
+
+  Value *cond = evalRVal(ast);
+  if (auto *C = dynamic_cast<ConstantInt *>(cond)) {
+    builder_->createJump(C->getValue() ? trueBB : falseBB);
+    return;
+  }
+  builder_->createCondBr(cond, trueBB, falseBB);
+}
+
 int IRGenVisitor::evalConstExpr(const BaseAST *ast) {
   if (const auto *num = dynamic_cast<const NumberAST *>(ast)) {
     return num->val;
@@ -842,6 +891,24 @@ void IRGenVisitor::initializeLocalArray(const InitVarAST *init, Value *baseAddr,
     initValues.push_back(ConstantInt::get(Type::getInt32Ty(), 0));
   }
 
+  auto isZero = [](Value *val) {
+    auto *c = dynamic_cast<ConstantInt *>(val);
+    return c && c->getValue() == 0;
+  };
+
+  // Mostly-zero initializer: clear everything first, then skip the zeros
+  int num_zeros = 0;
+  for (Value *val : initValues)
+    num_zeros += isZero(val);
+  bool zero_filled = num_zeros >= ZeroFillThreshold;
+  if (zero_filled) {
+    Value *first = baseAddr;
+    for (size_t d = 0; d < dims.size(); ++d)
+      first = builder_->createGetElemPtr(
+          first, ConstantInt::get(Type::getInt32Ty(), 0));
+    emitZeroFill(first, total_elements);
+  }
+
   // Store values into array
   std::vector<int> current_idx(dims.size(), 0);
   for (int i = 0; i < total_elements; ++i) {
@@ -850,13 +917,15 @@ void IRGenVisitor::initializeLocalArray(const InitVarAST *init, Value *baseAddr,
       // Check bitwidth if strict, for now assume i32
     }
 
-    // Generate GEP to element
-    Value *ptr = baseAddr;
-    for (int d = 0; d < dims.size(); ++d) {
-      ptr = builder_->createGetElemPtr(
-          ptr, ConstantInt::get(Type::getInt32Ty(), current_idx[d]));
+    if (!zero_filled || !isZero(val)) {
+      // Generate GEP to element
+      Value *ptr = baseAddr;
+      for (int d = 0; d < dims.size(); ++d) {
+        ptr = builder_->createGetElemPtr(
+            ptr, ConstantInt::get(Type::getInt32Ty(), current_idx[d]));
+      }
+      builder_->createStore(val, ptr);
     }
-    builder_->createStore(val, ptr);
 
     // Increment multi-dim index
     for (int d = dims.size() - 1; d >= 0; --d) {
@@ -868,6 +937,52 @@ void IRGenVisitor::initializeLocalArray(const InitVarAST *init, Value *baseAddr,
   }
 }
 
+void IRGenVisitor::emitZeroFill(Value *ptr, int count) {
+  Function *func = builder_->getInsertBlock()->getParent();
+  Type *i32 = Type::getInt32Ty();
+  Value *zero = ConstantInt::get(i32, 0);
+  int loop_count = count - count % ZeroFillUnroll;
+
+  // for (i = 0; i < loop_count; i += ZeroFillUnroll) ptr[i..i+3] = 0;
+  BasicBlock *condBB = BasicBlock::create(*func, "zero_cond");
+  BasicBlock *bodyBB = BasicBlock::create(*func, "zero_body");
+  BasicBlock *endBB = BasicBlock::create(*func, "zero_end");
+
+  Value *counter = builder_->createAlloca(i32);
+  builder_->createStore(zero, counter);
+  builder_->createJump(condBB);
+
+  func->addBasicBlock(condBB);
+  builder_->setInsertPoint(condBB);
+  Value *idx = builder_->createLoad(counter);
+  Value *cond = builder_->createBinaryOp(Instruction::Opcode::Lt, idx,
+                                         ConstantInt::get(i32, loop_count));
+  builder_->createCondBr(cond, bodyBB, endBB);
+
+  func->addBasicBlock(bodyBB);
+  builder_->setInsertPoint(bodyBB);
+  Value *elem = builder_->createGetPtr(ptr, idx);
+  for (int k = 0; k < ZeroFillUnroll; ++k) {
+    Value *slot = elem;
+    if (k > 0)
+      slot = builder_->createGetPtr(elem, ConstantInt::get(i32, k));
+    builder_->createStore(zero, slot);
+  }
+  Value *next = builder_->createBinaryOp(Instruction::Opcode::Add, idx,
+                                         ConstantInt::get(i32, ZeroFillUnroll));
+  builder_->createStore(next, counter);
+  builder_->createJump(condBB);
+
+  func->addBasicBlock(endBB);
+  builder_->setInsertPoint(endBB);
+
+  // remainder
+  for (int i = loop_count; i < count; ++i) {
+    Value *slot = builder_->createGetPtr(ptr, ConstantInt::get(i32, i));
+    builder_->createStore(zero, slot);
+  }
+}
+
 Constant *IRGenVisitor::evalConstant(const InitVarAST *init, Type *ty) {
   if (init->initExpr) {
     return dynamic_cast<Constant *>(evalRVal(init->initExpr.get()));
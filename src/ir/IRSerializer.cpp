@@ -95,7 +95,42 @@ static void SerializeConstant(const Constant *c, std::ostream &os) {
   }
 }
 
+/// Koopa IR has no select, so `%r = select c, t, f` is spelled as the mask
+/// sequence f ^ ((t ^ f) & -c):
+///
+///   %select_r_cond = ne c, 0         (only if c may be other than 0 or 1)
+///   %select_r_mask = sub 0, %select_r_cond
+///   %select_r_diff = xor t, f
+///   %select_r_bits = and %select_r_diff, %select_r_mask
+///   %r = xor f, %select_r_bits
+///
+/// The backend recognizes this shape and emits it without the temporaries.
+static void SerializeSelect(const Instruction *inst, std::ostream &os) {
+  std::string name = getValName(inst);
+  std::string prefix = "%select_" + name.substr(1);
+  std::string cond = getValName(inst->getOperand(0));
+  std::string trueVal = getValName(inst->getOperand(1));
+  std::string falseVal = getValName(inst->getOperand(2));
+
+  auto *condInst = dynamic_cast<const Instruction *>(inst->getOperand(0));
+  if (!condInst || !condInst->isComparison()) {
+    os << "  " << prefix << "_cond = ne " << cond << ", 0\n";
+    cond = prefix + "_cond";
+  }
+  os << "  " << prefix << "_mask = sub 0, " << cond << "\n";
+  os << "  " << prefix << "_diff = xor " << trueVal << ", " << falseVal
+     << "\n";
+  os << "  " << prefix << "_bits = and " << prefix << "_diff, " << prefix
+     << "_mask\n";
+  os << "  " << name << " = xor " << falseVal << ", " << prefix << "_bits\n";
+}
+
 static void SerializeInstruction(const Instruction *inst, std::ostream &os) {
+  if (inst->getOpcode() == Instruction::Opcode::Select) {
+    SerializeSelect(inst, os);
+    return;
+  }
+
   if (!inst->getType()->isVoidTy()) {
     os << "  " << getValName(inst) << " = ";
   } else {
@@ -176,6 +211,22 @@ static void SerializeInstruction(const Instruction *inst, std::ostream &os) {
     os << "or " << getValName(inst->getOperand(0)) << ", "
        << getValName(inst->getOperand(1));
     break;
+  case Instruction::Opcode::Xor:
+    os << "xor " << getValName(inst->getOperand(0)) << ", "
+       << getValName(inst->getOperand(1));
+    break;
+  case Instruction::Opcode::Shl:
+    os << "shl " << getValName(inst->getOperand(0)) << ", "
+       << getValName(inst->getOperand(1));
+    break;
+  case Instruction::Opcode::Shr:
+    os << "shr " << getValName(inst->getOperand(0)) << ", "
+       << getValName(inst->getOperand(1));
+    break;
+  case Instruction::Opcode::Sar:
+    os << "sar " << getValName(inst->getOperand(0)) << ", "
+       << getValName(inst->getOperand(1));
+    break;
   case Instruction::Opcode::Br:
     if (inst->getNumOperands() == 3) {
       os << "br " << getValName(inst->getOperand(0)) << ", "
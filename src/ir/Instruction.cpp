@@ -0,0 +1,22 @@
+#include "nanocc/ir/Instruction.h"
+#include "nanocc/ir/BasicBlock.h"
+#include <cassert>
+
+namespace nanocc {
+
+void Instruction::eraseFromParent() {
+  assert(use_empty() && "Erasing an instruction that still has uses");
+  assert(parent_ && "Instruction is not inserted into a basic block");
+  dropAllReferences();
+
+  auto &instList = parent_->getInstList();
+  for (auto it = instList.begin(); it != instList.end(); ++it) {
+    if (it->get() == this) {
+      instList.erase(it); // deletes this
+      return;
+    }
+  }
+  assert(false && "Instruction not found in its parent block");
+}
+
+} // namespace nanocc
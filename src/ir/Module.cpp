@@ -1,8 +1,10 @@
 
 #include "nanocc/ir/Module.h"
+#include "nanocc/ir/BasicBlock.h"
 #include "nanocc/ir/Function.h"
 #include "nanocc/ir/GlobalVariable.h"
 #include "nanocc/ir/Type.h"
+#include <cassert>
 
 namespace nanocc {
 
@@ -29,6 +31,17 @@ Function *Module::getOrInsertFunction(const std::string &name, Type *retTy,
   return F;
 }
 
+void Module::eraseFunction(Function *F) {
+  assert(F->use_empty() && "Erasing a function that is still referenced");
+  // instructions refer to each other, so unlink every use before deleting
+  for (BasicBlock *BB : F->getBasicBlockList())
+    for (auto &I : BB->getInstList())
+      I->dropAllReferences();
+  functionList_.remove(F);
+  valSymTab_.erase(F->getName());
+  delete F;
+}
+
 GlobalVariable *Module::getGlobalVariable(const std::string &name) {
   auto *GV = valSymTab_.lookup(name);
   if (GV && dynamic_cast<GlobalVariable *>(GV)) {
@@ -50,4 +63,12 @@ GlobalVariable *Module::getOrInsertGlobal(const std::string &name, Type *ty,
   return GV;
 }
 
-} // namespace nanocc
\ No newline at end of file
+void Module::eraseGlobalVariable(GlobalVariable *GV) {
+  assert(GV->use_empty() && "Erasing a global that is still referenced");
+  GV->dropAllReferences();
+  globalList_.remove(GV);
+  valSymTab_.erase(GV->getName());
+  delete GV;
+}
+
+} // namespace nanocc
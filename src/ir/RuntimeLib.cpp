@@ -0,0 +1,135 @@
+#include "nanocc/ir/RuntimeLib.h"
+#include "nanocc/ir/BasicBlock.h"
+#include "nanocc/ir/Constant.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/IRBuilder.h"
+#include "nanocc/ir/Module.h"
+#include "nanocc/ir/Type.h"
+#include <algorithm>
+#include <functional>
+
+namespace nanocc {
+namespace RuntimeLib {
+
+/// Words handled per iteration of the main loop
+static constexpr int Unroll = 8;
+
+using LoopBodyFn = std::function<void(IRBuilder &, Value *idx, int count)>;
+
+/// Emit the body of \p F as
+///
+///   for (i = 0; i < len - (Unroll - 1); i += Unroll) body(i, Unroll);
+///   for (; i < len; i += 1) body(i, 1);
+///   ret
+static void emitUnrolledLoop(Function *F, Value *len, const LoopBodyFn &body) {
+  Type *i32 = Type::getInt32Ty();
+  BasicBlock *entryBB = BasicBlock::create(*F, "entry");
+  BasicBlock *mainCondBB = BasicBlock::create(*F, "main_cond");
+  BasicBlock *mainBodyBB = BasicBlock::create(*F, "main_body");
+  BasicBlock *tailCondBB = BasicBlock::create(*F, "tail_cond");
+  BasicBlock *tailBodyBB = BasicBlock::create(*F, "tail_body");
+  BasicBlock *endBB = BasicBlock::create(*F, "end");
+
+  IRBuilder builder;
+  F->addBasicBlock(entryBB);
+  builder.setInsertPoint(entryBB);
+  Value *counter = builder.createAlloca(i32);
+  builder.createStore(ConstantInt::get(i32, 0), counter);
+  Value *mainLen = builder.createBinaryOp(Instruction::Opcode::Sub, len,
+                                          ConstantInt::get(i32, Unroll - 1));
+  builder.createJump(mainCondBB);
+
+  auto emitLoop = [&](BasicBlock *condBB, BasicBlock *bodyBB, Value *limit,
+                      BasicBlock *exitBB, int step) {
+    F->addBasicBlock(condBB);
+    builder.setInsertPoint(condBB);
+    Value *idx = builder.createLoad(counter);
+    Value *cond = builder.createBinaryOp(Instruction::Opcode::Lt, idx, limit);
+    builder.createCondBr(cond, bodyBB, exitBB);
+
+    F->addBasicBlock(bodyBB);
+    builder.setInsertPoint(bodyBB);
+    body(builder, idx, step);
+    Value *next = builder.createBinaryOp(Instruction::Opcode::Add, idx,
+                                         ConstantInt::get(i32, step));
+    builder.createStore(next, counter);
+    builder.createJump(condBB);
+  };
+  emitLoop(mainCondBB, mainBodyBB, mainLen, tailCondBB, Unroll);
+  emitLoop(tailCondBB, tailBodyBB, len, endBB, 1);
+
+  F->addBasicBlock(endBB);
+  builder.setInsertPoint(endBB);
+  builder.createRetVoid();
+}
+
+/// Address of word \p k after \p base
+static Value *offsetPtr(IRBuilder &builder, Value *base, int k) {
+  if (k == 0)
+    return base;
+  return builder.createGetPtr(base, ConstantInt::get(Type::getInt32Ty(), k));
+}
+
+static Function *createFunction(Module &M, const char *name,
+                                std::vector<Type *> params,
+                                std::initializer_list<const char *> argNames) {
+  FunctionType *FT = FunctionType::get(Type::getVoidTy(), params);
+  Function *F = Function::create(FT, Function::InternalLinkage, name, M);
+  // Koopa wants callees defined before their callers
+  auto &functions = M.getFunctionList();
+  functions.pop_back();
+  functions.insert(std::find_if(functions.begin(), functions.end(),
+                                [](Function *G) { return !G->isDeclaration(); }),
+                   F);
+  unsigned i = 0;
+  for (const char *argName : argNames)
+    F->getArgs()[i++]->setName(argName);
+  return F;
+}
+
+Function *getOrInsertMemset(Module &M) {
+  if (Function *F = M.getFunction(MemsetName))
+    return F;
+
+  Type *i32 = Type::getInt32Ty();
+  Type *ptrTy = Type::getPointerTy(i32);
+  Function *F =
+      createFunction(M, MemsetName, {ptrTy, i32, i32}, {"dst", "val", "len"});
+  F->setMemoryEffects({NoModRef, Mod, false});
+  Value *dst = F->getArgs()[0];
+  Value *val = F->getArgs()[1];
+  emitUnrolledLoop(F, F->getArgs()[2],
+                   [&](IRBuilder &builder, Value *idx, int count) {
+                     Value *d = builder.createGetPtr(dst, idx);
+                     for (int k = 0; k < count; ++k)
+                       builder.createStore(val, offsetPtr(builder, d, k));
+                   });
+  return F;
+}
+
+Function *getOrInsertMemcpy(Module &M) {
+  if (Function *F = M.getFunction(MemcpyName))
+    return F;
+
+  Type *i32 = Type::getInt32Ty();
+  Type *ptrTy = Type::getPointerTy(i32);
+  Function *F = createFunction(M, MemcpyName, {ptrTy, ptrTy, i32},
+                               {"dst", "src", "len"});
+  F->setMemoryEffects({NoModRef, ModRef, false});
+  Value *dst = F->getArgs()[0];
+  Value *src = F->getArgs()[1];
+  emitUnrolledLoop(F, F->getArgs()[2],
+                   [&](IRBuilder &builder, Value *idx, int count) {
+                     Value *d = builder.createGetPtr(dst, idx);
+                     Value *s = builder.createGetPtr(src, idx);
+                     // load/store pairs keep overlapping copies exact
+                     for (int k = 0; k < count; ++k) {
+                       Value *v = builder.createLoad(offsetPtr(builder, s, k));
+                       builder.createStore(v, offsetPtr(builder, d, k));
+                     }
+                   });
+  return F;
+}
+
+} // namespace RuntimeLib
+} // namespace nanocc
@@ -28,6 +28,14 @@ bool ValueSymbolTable::insert(const std::string &name, Value *val) {
   return true;
 }
 
+bool ValueSymbolTable::erase(const std::string &name) {
+  for (auto it = layers_.rbegin(); it != layers_.rend(); ++it) {
+    if (it->erase(name))
+      return true;
+  }
+  return false;
+}
+
 Value *ValueSymbolTable::lookup(const std::string &name) const {
   for (auto it = layers_.rbegin(); it != layers_.rend(); ++it) {
     auto found = it->find(name);
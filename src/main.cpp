@@ -4,6 +4,7 @@
 #include "nanocc/ir/IRGenVisitor.h"
 #include "nanocc/ir/IRSerializer.h"
 #include "nanocc/ir/Module.h"
+#include "nanocc/transforms/PassPipeline.h"
 
 #include <cassert>
 #include <cstdio>
@@ -22,7 +23,7 @@ extern FILE *yyin;
 extern int yyparse(unique_ptr<BaseAST> &ast);
 
 int main(int argc, const char *argv[]) {
-  assert(argc == 5);
+  assert(argc >= 5);
 
   string mode(argv[1]);  // 模式: -koopa or -riscv
   auto input = argv[2];  // 输入文件
@@ -33,6 +34,23 @@ int main(int argc, const char *argv[]) {
     return 1;
   }
 
+  // 输出文件之后的可选优化开关
+  PipelineOptions options;
+  bool zicond = false; // 目标支持 Zicond 扩展
+  for (int i = 5; i < argc; ++i) {
+    string flag(argv[i]);
+    if (flag == "-fmemoize") {
+      options.memoize = true;
+    } else if (flag == "-fif-convert") {
+      options.ifConvert = true;
+    } else if (flag == "-mzicond") {
+      zicond = true;
+    } else {
+      cerr << "Error: Unsupported option " << flag << endl;
+      return 1;
+    }
+  }
+
   // open source file
   yyin = fopen(input, "r");
   assert(yyin);
@@ -52,6 +70,9 @@ int main(int argc, const char *argv[]) {
   IRGenVisitor irgen(module);
   ast->Accept(irgen);
 
+  // Optimize
+  runOptimizationPipeline(module, options);
+
   // Code generation
   if (mode == "-koopa") {
     // 生成 Koopa IR 文本
@@ -64,6 +85,8 @@ int main(int argc, const char *argv[]) {
     // 生成 RISC-V 汇编
     freopen(output, "w", stdout);
     ProgramCodeGen codegen;
+    codegen.SetReadOnlyGlobals(module);
+    codegen.SetZicond(zicond);
     codegen.Emit(IRSerializer::ToProgram(module));
     fclose(stdout);
   }
@@ -0,0 +1,63 @@
+#include "nanocc/transforms/Cloning.h"
+#include "nanocc/ir/BasicBlock.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/Instruction.h"
+#include "nanocc/ir/Module.h"
+#include "nanocc/ir/Type.h"
+#include <algorithm>
+
+namespace nanocc {
+
+BasicBlock *cloneBasicBlock(BasicBlock *BB, Function &F,
+                            const std::string &Name, ValueMap &VMap) {
+  BasicBlock *newBB = BasicBlock::create(F, Name);
+  F.addBasicBlock(newBB);
+  VMap[BB] = newBB;
+  for (auto &I : BB->getInstList()) {
+    auto copy = Instruction::create(I->getType(), I->getOpcode(),
+                                    I->getNumOperands(), newBB);
+    for (unsigned i = 0; i < I->getNumOperands(); ++i)
+      copy->setOperand(i, I->getOperand(i));
+    VMap[I.get()] = copy.get();
+    newBB->getInstList().push_back(std::move(copy));
+  }
+  return newBB;
+}
+
+void remapInstruction(Instruction *I, const ValueMap &VMap) {
+  for (unsigned i = 0; i < I->getNumOperands(); ++i) {
+    auto it = VMap.find(I->getOperand(i));
+    if (it != VMap.end())
+      I->setOperand(i, it->second);
+  }
+}
+
+Function *cloneFunction(Function *F, const std::string &Name, Module &M,
+                        ValueMap &VMap) {
+  auto *FT = static_cast<FunctionType *>(F->getType());
+  Function *newF = Function::create(FT, F->getLinkage(), Name, M);
+  newF->setMemoryEffects(F->getMemoryEffects());
+  auto &functions = M.getFunctionList();
+  functions.pop_back();
+  functions.insert(std::next(std::find(functions.begin(), functions.end(), F)),
+                   newF);
+
+  for (size_t i = 0; i < F->getArgs().size(); ++i) {
+    newF->getArgs()[i]->setName(F->getArgs()[i]->getName());
+    VMap[F->getArgs()[i]] = newF->getArgs()[i];
+  }
+
+  // block names carry the function name as prefix, see getUniqueName
+  const size_t prefixLen = F->getName().size() + 1;
+  for (BasicBlock *BB : F->getBasicBlockList()) {
+    std::string name = BB->getName();
+    name = name.size() > prefixLen ? name.substr(prefixLen) : "";
+    cloneBasicBlock(BB, *newF, name, VMap);
+  }
+  for (BasicBlock *BB : newF->getBasicBlockList())
+    for (auto &I : BB->getInstList())
+      remapInstruction(I.get(), VMap);
+  return newF;
+}
+
+} // namespace nanocc
@@ -0,0 +1,138 @@
+#include "nanocc/transforms/DeadArgElim.h"
+#include "nanocc/ir/BasicBlock.h"
+#include "nanocc/ir/Constant.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/IRBuilder.h"
+#include "nanocc/ir/Instruction.h"
+#include "nanocc/ir/Module.h"
+#include "nanocc/ir/Type.h"
+#include "nanocc/transforms/IPOUtils.h"
+
+namespace nanocc {
+
+using Opcode = Instruction::Opcode;
+
+/// \p Call passes argument \p ArgNo of its own function straight back
+static bool isPassthrough(Instruction *Call, unsigned ArgNo) {
+  Function *F = Call->getParent()->getParent();
+  return Call->getOperand(0) == F &&
+         Call->getOperand(ArgNo + 1) == F->getArgs()[ArgNo];
+}
+
+/// Constant every call site passes as argument \p ArgNo, if there is one
+static Value *getCommonActual(const std::vector<Instruction *> &Calls,
+                              unsigned ArgNo) {
+  Value *common = nullptr;
+  for (Instruction *call : Calls) {
+    if (isPassthrough(call, ArgNo))
+      continue;
+    Value *actual = call->getOperand(ArgNo + 1);
+    if (!common) {
+      common = actual;
+      continue;
+    }
+    auto *C1 = dynamic_cast<ConstantInt *>(common);
+    auto *C2 = dynamic_cast<ConstantInt *>(actual);
+    if (actual != common && !(C1 && C2 && C1->getValue() == C2->getValue()))
+      return nullptr;
+  }
+  return dynamic_cast<ConstantInt *>(common) ? common : nullptr;
+}
+
+bool DeadArgElimPass::runOnFunction(Function &F,
+                                    std::vector<Instruction *> &Calls) {
+  bool changed = false;
+  const unsigned numArgs = F.getArgs().size();
+  std::vector<bool> deadArgs(numArgs, false);
+  bool anyDeadArg = false;
+
+  for (unsigned i = 0; i < numArgs; ++i) {
+    Argument *arg = F.getArgs()[i];
+    if (Value *V = getCommonActual(Calls, i)) {
+      // keep the passthrough uses, they go away with the argument
+      for (Use *U = arg->use_begin(); U != arg->use_end();) {
+        Use *next = U->getNext();
+        auto *user = static_cast<Instruction *>(U->getUser());
+        if (!(user->getOpcode() == Opcode::Call && isPassthrough(user, i))) {
+          U->set(V);
+          changed = true;
+        }
+        U = next;
+      }
+    }
+
+    bool dead = true;
+    for (Use *U = arg->use_begin(); U != arg->use_end() && dead;
+         U = U->getNext()) {
+      auto *user = static_cast<Instruction *>(U->getUser());
+      dead = user->getOpcode() == Opcode::Call && isPassthrough(user, i);
+    }
+    deadArgs[i] = dead;
+    anyDeadArg |= dead;
+  }
+
+  // the result is dead if it is only returned again by a recursive call
+  Type *retTy = F.getType()->getFunctionReturnType();
+  bool deadRet = !retTy->isVoidTy();
+  for (Instruction *call : Calls) {
+    for (Use *U = call->use_begin(); U != call->use_end() && deadRet;
+         U = U->getNext()) {
+      auto *user = static_cast<Instruction *>(U->getUser());
+      deadRet = user->getOpcode() == Opcode::Ret &&
+                user->getParent()->getParent() == &F;
+    }
+  }
+  if (!anyDeadArg && !deadRet)
+    return changed;
+
+  IRBuilder builder;
+  if (deadRet) {
+    for (BasicBlock *BB : F.getBasicBlockList()) {
+      Instruction *ret = BB->getTerminator();
+      if (!ret || ret->getOpcode() != Opcode::Ret)
+        continue;
+      builder.setInsertPoint(ret);
+      builder.createRetVoid();
+      ret->eraseFromParent();
+    }
+  }
+
+  for (Instruction *call : Calls) {
+    std::vector<Value *> args;
+    for (unsigned i = 0; i < numArgs; ++i)
+      if (!deadArgs[i])
+        args.push_back(call->getOperand(i + 1));
+    builder.setInsertPoint(call);
+    auto newCall =
+        Instruction::create(deadRet ? Type::getVoidTy() : call->getType(),
+                            Opcode::Call, args.size() + 1);
+    newCall->setOperand(0, &F);
+    for (size_t i = 0; i < args.size(); ++i)
+      newCall->setOperand(i + 1, args[i]);
+    Instruction *replacement = builder.insert(std::move(newCall));
+    if (!call->use_empty())
+      call->replaceAllUsesWith(replacement);
+    call->eraseFromParent();
+  }
+
+  for (unsigned i = numArgs; i-- > 0;)
+    if (deadArgs[i])
+      F.eraseArgument(i);
+  if (deadRet)
+    F.setReturnType(Type::getVoidTy());
+  return true;
+}
+
+bool DeadArgElimPass::run(Module &M) {
+  bool changed = false;
+  for (Function *F : M.getFunctionList()) {
+    if (F->isDeclaration() || F->getName() == "main")
+      continue;
+    std::vector<Instruction *> calls;
+    if (collectCallSites(F, calls) && !calls.empty())
+      changed |= runOnFunction(*F, calls);
+  }
+  return changed;
+}
+
+} // namespace nanocc
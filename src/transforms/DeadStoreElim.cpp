@@ -0,0 +1,203 @@
+#include "nanocc/transforms/DeadStoreElim.h"
+#include "nanocc/ir/BasicBlock.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/Instruction.h"
+#include "nanocc/ir/Type.h"
+#include "nanocc/ir/Value.h"
+#include <algorithm>
+#include <unordered_map>
+
+namespace nanocc {
+
+using Opcode = Instruction::Opcode;
+
+/// Bound on pending overwritten pointers in a block, see LoadElim
+static constexpr size_t MaxPendingStores = 64;
+
+/// Collect every store whose address is derived from \p Obj, or return
+/// false if anything reads through such an address.
+static bool collectStoresIfUnread(Instruction *Obj,
+                                  std::vector<Instruction *> &Stores) {
+  std::vector<Value *> worklist{Obj};
+  while (!worklist.empty()) {
+    Value *P = worklist.back();
+    worklist.pop_back();
+    for (Use *U = P->use_begin(); U != P->use_end(); U = U->getNext()) {
+      auto *user = static_cast<Instruction *>(U->getUser());
+      if (user->getOpcode() == Opcode::Store)
+        Stores.push_back(user);
+      else if (user->getOpcode() == Opcode::GetElemPtr ||
+               user->getOpcode() == Opcode::GetPtr)
+        worklist.push_back(user);
+      else
+        return false;
+    }
+  }
+  return true;
+}
+
+bool DeadStoreElimPass::removeUnreadLocals(Function &F) {
+  bool changed = false;
+  for (BasicBlock *BB : F.getBasicBlockList()) {
+    for (auto &I : BB->getInstList()) {
+      if (I->getOpcode() != Opcode::Alloc || !AA_.isNonEscapingLocal(I.get()))
+        continue;
+      std::vector<Instruction *> stores;
+      if (!collectStoresIfUnread(I.get(), stores))
+        continue;
+      for (Instruction *S : stores)
+        S->eraseFromParent();
+      changed |= !stores.empty();
+    }
+  }
+  return changed;
+}
+
+/// Scalar `alloc` only used as the address of plain loads and stores
+static bool isDirectlyAccessedSlot(Instruction *I) {
+  if (I->getOpcode() != Opcode::Alloc ||
+      I->getType()->getPointerElementType()->isArrayTy())
+    return false;
+  for (Use *U = I->use_begin(); U != I->use_end(); U = U->getNext()) {
+    auto *user = static_cast<Instruction *>(U->getUser());
+    if (user->getOpcode() == Opcode::Load)
+      continue;
+    if (user->getOpcode() == Opcode::Store && user->getOperand(1) == I &&
+        user->getOperand(0) != I)
+      continue;
+    return false;
+  }
+  return true;
+}
+
+bool DeadStoreElimPass::removeDeadScalarStores(Function &F) {
+  // number the scalar slots
+  std::unordered_map<Value *, unsigned> slotIndex;
+  for (BasicBlock *BB : F.getBasicBlockList()) {
+    for (auto &I : BB->getInstList()) {
+      if (isDirectlyAccessedSlot(I.get()))
+        slotIndex.emplace(I.get(), slotIndex.size());
+    }
+  }
+  if (slotIndex.empty())
+    return false;
+
+  auto getSlot = [&](Value *Ptr) -> int {
+    auto it = slotIndex.find(Ptr);
+    return it == slotIndex.end() ? -1 : static_cast<int>(it->second);
+  };
+
+  using LiveSet = std::vector<bool>;
+  const unsigned numSlots = slotIndex.size();
+  std::unordered_map<BasicBlock *, LiveSet> liveIn;
+  for (BasicBlock *BB : F.getBasicBlockList())
+    liveIn[BB] = LiveSet(numSlots, false);
+
+  auto computeLiveOut = [&](BasicBlock *BB) {
+    LiveSet live(numSlots, false);
+    for (BasicBlock *succ : BB->getSuccessors())
+      for (unsigned i = 0; i < numSlots; ++i)
+        if (liveIn[succ][i])
+          live[i] = true;
+    return live;
+  };
+
+  // backward transfer over one instruction
+  auto step = [&](Instruction *I, LiveSet &live) {
+    int slot;
+    if (I->getOpcode() == Opcode::Load && (slot = getSlot(I->getOperand(0))) >= 0)
+      live[slot] = true;
+    else if (I->getOpcode() == Opcode::Store &&
+             (slot = getSlot(I->getOperand(1))) >= 0)
+      live[slot] = false;
+  };
+
+  auto &blocks = F.getBasicBlockList();
+  bool iterate = true;
+  while (iterate) {
+    iterate = false;
+    for (auto bbIt = blocks.rbegin(); bbIt != blocks.rend(); ++bbIt) {
+      BasicBlock *BB = *bbIt;
+      LiveSet live = computeLiveOut(BB);
+      auto &instList = BB->getInstList();
+      for (auto it = instList.rbegin(); it != instList.rend(); ++it)
+        step(it->get(), live);
+      if (live != liveIn[BB]) {
+        liveIn[BB] = std::move(live);
+        iterate = true;
+      }
+    }
+  }
+
+  bool changed = false;
+  for (BasicBlock *BB : blocks) {
+    LiveSet live = computeLiveOut(BB);
+    auto &instList = BB->getInstList();
+    for (auto it = instList.end(); it != instList.begin();) {
+      Instruction *I = (--it)->get();
+      int slot;
+      if (I->getOpcode() == Opcode::Store &&
+          (slot = getSlot(I->getOperand(1))) >= 0 && !live[slot]) {
+        I->dropAllReferences();
+        it = instList.erase(it);
+        changed = true;
+        continue;
+      }
+      step(I, live);
+    }
+  }
+  return changed;
+}
+
+bool DeadStoreElimPass::removeOverwrittenStores(BasicBlock *BB) {
+  // pointers stored to later in the block with no read in between
+  std::vector<Value *> overwritten;
+  bool changed = false;
+
+  auto &instList = BB->getInstList();
+  for (auto it = instList.end(); it != instList.begin();) {
+    Instruction *I = (--it)->get();
+    switch (I->getOpcode()) {
+    case Opcode::Store: {
+      Value *ptr = I->getOperand(1);
+      bool dead = false;
+      for (Value *later : overwritten) {
+        if (later == ptr || AA_.alias(later, ptr) == AliasResult::MustAlias) {
+          dead = true;
+          break;
+        }
+      }
+      if (dead) {
+        I->dropAllReferences();
+        it = instList.erase(it);
+        changed = true;
+        continue;
+      }
+      if (overwritten.size() < MaxPendingStores)
+        overwritten.push_back(ptr);
+      break;
+    }
+    case Opcode::Load:
+    case Opcode::Call:
+      overwritten.erase(std::remove_if(overwritten.begin(), overwritten.end(),
+                                       [&](Value *P) {
+                                         return AA_.getModRefInfo(I, P) & Ref;
+                                       }),
+                        overwritten.end());
+      break;
+    default:
+      break;
+    }
+  }
+  return changed;
+}
+
+bool DeadStoreElimPass::run(Function &F) {
+  bool changed = removeUnreadLocals(F);
+  changed |= removeDeadScalarStores(F);
+  for (BasicBlock *BB : F.getBasicBlockList())
+    changed |= removeOverwrittenStores(BB);
+  return changed;
+}
+
+} // namespace nanocc
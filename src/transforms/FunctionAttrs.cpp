@@ -0,0 +1,90 @@
+#include "nanocc/transforms/FunctionAttrs.h"
+#include "nanocc/ir/BasicBlock.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/GlobalVariable.h"
+#include "nanocc/ir/Instruction.h"
+#include "nanocc/ir/Module.h"
+#include "nanocc/ir/Type.h"
+#include <unordered_map>
+
+namespace nanocc {
+
+using Opcode = Instruction::Opcode;
+
+MemoryEffects FunctionAttrsPass::getAccessEffects(Value *Ptr, ModRefInfo MR) {
+  Value *base = AA_.getUnderlyingObject(Ptr);
+  auto *I = dynamic_cast<Instruction *>(base);
+  if (I && I->getOpcode() == Opcode::Alloc)
+    return MemoryEffects::none();
+  if (dynamic_cast<GlobalVariable *>(base))
+    return {MR, NoModRef, false};
+  if (dynamic_cast<Argument *>(base))
+    return {NoModRef, MR, false};
+  return {MR, MR, false};
+}
+
+MemoryEffects FunctionAttrsPass::computeEffects(Function &F) {
+  MemoryEffects result = MemoryEffects::none();
+  for (BasicBlock *BB : F.getBasicBlockList()) {
+    for (auto &I : BB->getInstList()) {
+      switch (I->getOpcode()) {
+      case Opcode::Load:
+        result |= getAccessEffects(I->getOperand(0), Ref);
+        break;
+      case Opcode::Store:
+        result |= getAccessEffects(I->getOperand(1), Mod);
+        break;
+      case Opcode::Call: {
+        auto *callee = dynamic_cast<Function *>(I->getOperand(0));
+        if (!callee)
+          return MemoryEffects();
+        const MemoryEffects &CE = callee->getMemoryEffects();
+        result.globals |= CE.globals;
+        result.io |= CE.io;
+        if (CE.args == NoModRef)
+          break;
+        for (unsigned i = 1; i < I->getNumOperands(); ++i)
+          if (I->getOperand(i)->getType()->isPointerTy())
+            result |= getAccessEffects(I->getOperand(i), CE.args);
+        break;
+      }
+      default:
+        break;
+      }
+    }
+  }
+  return result;
+}
+
+bool FunctionAttrsPass::run(Module &M) {
+  std::unordered_map<Function *, MemoryEffects> old;
+  for (Function *F : M.getFunctionList()) {
+    if (F->isDeclaration())
+      continue;
+    old[F] = F->getMemoryEffects();
+    F->setMemoryEffects(MemoryEffects::none());
+  }
+
+  // callees are defined before their callers, so this usually settles in
+  // one round plus a confirming one
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (Function *F : M.getFunctionList()) {
+      if (F->isDeclaration())
+        continue;
+      MemoryEffects ME = computeEffects(*F);
+      if (ME != F->getMemoryEffects()) {
+        F->setMemoryEffects(ME);
+        changed = true;
+      }
+    }
+  }
+
+  for (auto &[F, ME] : old)
+    if (F->getMemoryEffects() != ME)
+      return true;
+  return false;
+}
+
+} // namespace nanocc
@@ -0,0 +1,134 @@
+#include "nanocc/transforms/GlobalCodeMotion.h"
+#include "nanocc/analysis/Dominators.h"
+#include "nanocc/analysis/LoopInfo.h"
+#include "nanocc/ir/BasicBlock.h"
+#include "nanocc/ir/Constant.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/Instruction.h"
+#include "nanocc/transforms/LoopUtils.h"
+#include <vector>
+
+namespace nanocc {
+
+using Opcode = Instruction::Opcode;
+
+bool GlobalCodeMotionPass::isPinned(Instruction *I) {
+  if (!DT_->isReachable(I->getParent()))
+    return true;
+  switch (I->getOpcode()) {
+  case Opcode::Div:
+  case Opcode::Mod: {
+    // may not run on a path where the divisor is zero
+    auto *C = dynamic_cast<ConstantInt *>(I->getOperand(1));
+    return !C || C->getValue() == 0;
+  }
+  case Opcode::Select:
+  case Opcode::GetElemPtr:
+  case Opcode::GetPtr:
+    return false;
+  default:
+    return !I->isBinaryOp();
+  }
+}
+
+BasicBlock *GlobalCodeMotionPass::getBlock(Instruction *I) {
+  auto it = early_.find(I);
+  return it != early_.end() ? it->second : I->getParent();
+}
+
+BasicBlock *GlobalCodeMotionPass::findCommonDominator(BasicBlock *A,
+                                                      BasicBlock *B) {
+  if (!A)
+    return B;
+  while (A != B) {
+    if (domDepth_[A] >= domDepth_[B])
+      A = DT_->getIDom(A);
+    else
+      B = DT_->getIDom(B);
+  }
+  return A;
+}
+
+unsigned GlobalCodeMotionPass::getLoopDepth(BasicBlock *BB) {
+  Loop *L = LI_->getLoopFor(BB);
+  return L ? L->getLoopDepth() : 0;
+}
+
+void GlobalCodeMotionPass::scheduleEarly(Instruction *I, BasicBlock *Entry) {
+  // operands defined outside any instruction are available from the entry
+  BasicBlock *early = Entry;
+  for (unsigned i = 0; i < I->getNumOperands(); ++i) {
+    auto *op = dynamic_cast<Instruction *>(I->getOperand(i));
+    if (!op)
+      continue;
+    BasicBlock *BB = getBlock(op);
+    if (domDepth_[BB] > domDepth_[early])
+      early = BB;
+  }
+  early_[I] = early;
+}
+
+bool GlobalCodeMotionPass::scheduleLate(Instruction *I) {
+  BasicBlock *late = nullptr;
+  for (Use *U = I->use_begin(); U != I->use_end(); U = U->getNext()) {
+    auto *user = static_cast<Instruction *>(U->getUser());
+    if (!DT_->isReachable(user->getParent()))
+      return false;
+    late = findCommonDominator(late, user->getParent());
+  }
+  if (!late)
+    return false;
+
+  // the shallowest loop on the way up, as low as possible
+  BasicBlock *best = late;
+  for (BasicBlock *BB = late; BB != early_[I];) {
+    BB = DT_->getIDom(BB);
+    if (getLoopDepth(BB) < getLoopDepth(best))
+      best = BB;
+  }
+  if (best == I->getParent())
+    return false;
+
+  Instruction *pos = best->getTerminator();
+  for (auto &Inst : best->getInstList()) {
+    bool uses = false;
+    for (unsigned i = 0; i < Inst->getNumOperands(); ++i)
+      uses |= Inst->getOperand(i) == I;
+    if (uses) {
+      pos = Inst.get();
+      break;
+    }
+  }
+  moveBefore(I, pos);
+  return true;
+}
+
+bool GlobalCodeMotionPass::run(Function &F) {
+  DominatorTree DT(F);
+  LoopInfo LI(F, DT);
+  DT_ = &DT;
+  LI_ = &LI;
+  domDepth_.clear();
+  early_.clear();
+
+  // dominators come first in reverse postorder, and so do definitions
+  std::vector<Instruction *> pure;
+  for (BasicBlock *BB : DT.getReversePostOrder()) {
+    BasicBlock *idom = DT.getIDom(BB);
+    domDepth_[BB] = idom ? domDepth_[idom] + 1 : 0;
+    for (auto &I : BB->getInstList()) {
+      if (isPinned(I.get()))
+        continue;
+      scheduleEarly(I.get(), DT.getReversePostOrder().front());
+      pure.push_back(I.get());
+    }
+  }
+
+  // users are placed before the values they use
+  bool changed = false;
+  for (auto it = pure.rbegin(); it != pure.rend(); ++it)
+    changed |= scheduleLate(*it);
+  return changed;
+}
+
+} // namespace nanocc
@@ -0,0 +1,101 @@
+#include "nanocc/transforms/GlobalDCE.h"
+#include "nanocc/ir/BasicBlock.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/GlobalVariable.h"
+#include "nanocc/ir/Instruction.h"
+#include "nanocc/ir/Module.h"
+#include <unordered_set>
+#include <vector>
+
+namespace nanocc {
+
+using Opcode = Instruction::Opcode;
+
+bool GlobalDCEPass::removeWriteOnlyGlobal(GlobalVariable *GV) {
+  // addresses derived from GV, in def-before-use order
+  std::vector<Instruction *> derived;
+  std::vector<Instruction *> stores;
+  std::vector<Value *> worklist{GV};
+  while (!worklist.empty()) {
+    Value *P = worklist.back();
+    worklist.pop_back();
+    for (Use *U = P->use_begin(); U != P->use_end(); U = U->getNext()) {
+      auto *user = dynamic_cast<Instruction *>(U->getUser());
+      if (!user)
+        return false;
+      if (user->getOpcode() == Opcode::Store && user->getOperand(1) == P) {
+        stores.push_back(user);
+      } else if (user->getOpcode() == Opcode::GetElemPtr ||
+                 user->getOpcode() == Opcode::GetPtr) {
+        derived.push_back(user);
+        worklist.push_back(user);
+      } else {
+        return false;
+      }
+    }
+  }
+  if (stores.empty())
+    return false;
+
+  for (Instruction *S : stores)
+    S->eraseFromParent();
+  for (auto it = derived.rbegin(); it != derived.rend(); ++it)
+    if ((*it)->use_empty())
+      (*it)->eraseFromParent();
+  return true;
+}
+
+bool GlobalDCEPass::run(Module &M) {
+  Function *main = M.getFunction("main");
+  if (!main)
+    return false;
+
+  bool changed = false;
+  for (GlobalVariable *GV : M.getGlobalList())
+    changed |= removeWriteOnlyGlobal(GV);
+
+  // mark everything reachable from main
+  std::unordered_set<Value *> live{main};
+  std::vector<Function *> worklist{main};
+  while (!worklist.empty()) {
+    Function *F = worklist.back();
+    worklist.pop_back();
+    for (BasicBlock *BB : F->getBasicBlockList()) {
+      for (auto &I : BB->getInstList()) {
+        for (unsigned i = 0; i < I->getNumOperands(); ++i) {
+          Value *op = I->getOperand(i);
+          if (!dynamic_cast<Function *>(op) &&
+              !dynamic_cast<GlobalVariable *>(op))
+            continue;
+          if (live.insert(op).second)
+            if (auto *callee = dynamic_cast<Function *>(op))
+              worklist.push_back(callee);
+        }
+      }
+    }
+  }
+
+  // dead functions may call each other: unlink all of them first
+  std::vector<Function *> deadFunctions;
+  for (Function *F : M.getFunctionList()) {
+    if (live.count(F))
+      continue;
+    for (BasicBlock *BB : F->getBasicBlockList())
+      for (auto &I : BB->getInstList())
+        I->dropAllReferences();
+    deadFunctions.push_back(F);
+  }
+  for (Function *F : deadFunctions)
+    M.eraseFunction(F);
+
+  std::vector<GlobalVariable *> deadGlobals;
+  for (GlobalVariable *GV : M.getGlobalList())
+    if (!live.count(GV))
+      deadGlobals.push_back(GV);
+  for (GlobalVariable *GV : deadGlobals)
+    M.eraseGlobalVariable(GV);
+
+  return changed || !deadFunctions.empty() || !deadGlobals.empty();
+}
+
+} // namespace nanocc
@@ -0,0 +1,143 @@
+#include "nanocc/transforms/GlobalOpt.h"
+#include "nanocc/ir/BasicBlock.h"
+#include "nanocc/ir/Constant.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/GlobalVariable.h"
+#include "nanocc/ir/IRBuilder.h"
+#include "nanocc/ir/Instruction.h"
+#include "nanocc/ir/Module.h"
+#include "nanocc/ir/Type.h"
+#include <vector>
+
+namespace nanocc {
+
+using Opcode = Instruction::Opcode;
+
+/// Size of \p T counted in i32 words
+static int64_t getSizeInWords(Type *T) {
+  if (T->isArrayTy())
+    return T->getArrayNumElements() * getSizeInWords(T->getArrayElementType());
+  return 1;
+}
+
+/// Word \p Offset of the constant \p Init, or nullptr if out of range
+static ConstantInt *getInitializerWord(Constant *Init, Type *Ty,
+                                       int64_t Offset) {
+  if (Offset < 0 || Offset >= getSizeInWords(Ty))
+    return nullptr;
+  if (!Init || dynamic_cast<ConstantZero *>(Init))
+    return ConstantInt::get(Type::getInt32Ty(), 0);
+  if (auto *C = dynamic_cast<ConstantInt *>(Init))
+    return C;
+  if (auto *CA = dynamic_cast<ConstantArray *>(Init)) {
+    Type *elemTy = Ty->getArrayElementType();
+    int64_t elemSize = getSizeInWords(elemTy);
+    unsigned idx = Offset / elemSize;
+    // trailing elements may be left out of the initializer
+    if (idx >= CA->getNumOperands())
+      return ConstantInt::get(Type::getInt32Ty(), 0);
+    return getInitializerWord(static_cast<Constant *>(CA->getOperand(idx)),
+                              elemTy, Offset % elemSize);
+  }
+  return nullptr;
+}
+
+bool GlobalOptPass::isNeverWritten(GlobalVariable *GV) {
+  std::vector<Value *> worklist{GV};
+  while (!worklist.empty()) {
+    Value *P = worklist.back();
+    worklist.pop_back();
+    for (Use *U = P->use_begin(); U != P->use_end(); U = U->getNext()) {
+      auto *user = dynamic_cast<Instruction *>(U->getUser());
+      if (!user)
+        return false;
+      switch (user->getOpcode()) {
+      case Opcode::Load:
+        break;
+      case Opcode::GetElemPtr:
+      case Opcode::GetPtr:
+        worklist.push_back(user);
+        break;
+      default:
+        // stores, and calls that may write through the pointer
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool GlobalOptPass::foldLoads(Function &F) {
+  bool changed = false;
+  for (BasicBlock *BB : F.getBasicBlockList()) {
+    auto &instList = BB->getInstList();
+    for (auto it = instList.begin(); it != instList.end();) {
+      Instruction *I = (it++)->get();
+      if (I->getOpcode() != Opcode::Load)
+        continue;
+      PointerDecomposition D = AA_.decompose(I->getOperand(0));
+      auto *GV = dynamic_cast<GlobalVariable *>(D.base);
+      if (!GV || !GV->isConstant() || !D.varIndices.empty())
+        continue;
+      Type *valueTy = GV->getType()->getPointerElementType();
+      if (ConstantInt *C = getInitializerWord(GV->getInit(), valueTy,
+                                              D.offset)) {
+        I->replaceAllUsesWith(C);
+        I->eraseFromParent();
+        changed = true;
+      }
+    }
+  }
+  return changed;
+}
+
+bool GlobalOptPass::localizeIntoMain(GlobalVariable *GV, Function *Main) {
+  if (!GV->getType()->getPointerElementType()->isIntegerTy())
+    return false;
+  for (Use *U = GV->use_begin(); U != GV->use_end(); U = U->getNext()) {
+    auto *user = dynamic_cast<Instruction *>(U->getUser());
+    if (!user || user->getParent()->getParent() != Main)
+      return false;
+    bool direct = user->getOpcode() == Opcode::Load ||
+                  (user->getOpcode() == Opcode::Store &&
+                   user->getOperand(1) == GV && user->getOperand(0) != GV);
+    if (!direct)
+      return false;
+  }
+
+  BasicBlock *entry = Main->getBasicBlockList().front();
+  IRBuilder builder;
+  builder.setInsertPoint(entry->getInstList().front().get());
+  Instruction *slot = builder.createAlloca(Type::getInt32Ty(), GV->getName());
+  Value *init = GV->getInit();
+  if (!dynamic_cast<ConstantInt *>(init))
+    init = ConstantInt::get(Type::getInt32Ty(), 0);
+  builder.createStore(init, slot);
+  GV->replaceAllUsesWith(slot);
+  return true;
+}
+
+bool GlobalOptPass::run(Module &M) {
+  bool changed = false;
+  for (GlobalVariable *GV : M.getGlobalList()) {
+    if (!GV->isConstant() && isNeverWritten(GV)) {
+      GV->setConstant(true);
+      changed = true;
+    }
+  }
+  for (Function *F : M.getFunctionList())
+    changed |= foldLoads(*F);
+
+  Function *main = M.getFunction("main");
+  if (!main || main->isDeclaration() || !main->use_empty())
+    return changed;
+  std::vector<GlobalVariable *> localized;
+  for (GlobalVariable *GV : M.getGlobalList())
+    if (!GV->isConstant() && !GV->use_empty() && localizeIntoMain(GV, main))
+      localized.push_back(GV);
+  for (GlobalVariable *GV : localized)
+    M.eraseGlobalVariable(GV);
+  return changed || !localized.empty();
+}
+
+} // namespace nanocc
@@ -0,0 +1,20 @@
+#include "nanocc/transforms/IPOUtils.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/Instruction.h"
+
+namespace nanocc {
+
+bool collectCallSites(Function *F, std::vector<Instruction *> &Calls) {
+  for (Use *U = F->use_begin(); U != F->use_end(); U = U->getNext()) {
+    auto *user = dynamic_cast<Instruction *>(U->getUser());
+    if (!user || user->getOpcode() != Instruction::Opcode::Call)
+      return false;
+    for (unsigned i = 1; i < user->getNumOperands(); ++i)
+      if (user->getOperand(i) == F)
+        return false;
+    Calls.push_back(user);
+  }
+  return true;
+}
+
+} // namespace nanocc
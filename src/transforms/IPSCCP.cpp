@@ -0,0 +1,412 @@
+#include "nanocc/transforms/IPSCCP.h"
+#include "nanocc/analysis/Dominators.h"
+#include "nanocc/analysis/LoopInfo.h"
+#include "nanocc/ir/BasicBlock.h"
+#include "nanocc/ir/Constant.h"
+#include "nanocc/ir/ConstantFold.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/Instruction.h"
+#include "nanocc/ir/Module.h"
+#include "nanocc/ir/Type.h"
+#include "nanocc/ir/Value.h"
+#include "nanocc/transforms/Cloning.h"
+#include "nanocc/transforms/IPOUtils.h"
+#include <algorithm>
+#include <map>
+#include <string>
+#include <unordered_set>
+
+namespace nanocc {
+
+using Opcode = Instruction::Opcode;
+
+/// Callees larger than this are never copied
+static constexpr unsigned MaxSpecializationSize = 200;
+/// Total instructions all specializations of a module may add
+static constexpr unsigned SpecializationBudget = 800;
+static constexpr unsigned MaxSpecializationsPerFunction = 4;
+/// Specialized copies can expose new constant call sites, up to this depth
+static constexpr unsigned MaxSpecializationRounds = 2;
+
+static unsigned getInstructionCount(Function *F) {
+  unsigned count = 0;
+  for (BasicBlock *BB : F->getBasicBlockList())
+    count += BB->getInstList().size();
+  return count;
+}
+
+bool IPSCCPPass::isTrackedSlot(Value *V) {
+  auto *I = dynamic_cast<Instruction *>(V);
+  return I && I->getOpcode() == Opcode::Alloc &&
+         I->getType()->getPointerElementType()->isIntegerTy() &&
+         AA_.isNonEscapingLocal(I);
+}
+
+//===----------------------------------------------------------------------===//
+// Solver
+//
+
+IPSCCPPass::LatticeVal IPSCCPPass::getValue(Value *V) {
+  if (auto *C = dynamic_cast<ConstantInt *>(V))
+    return {LatticeVal::Constant, C->getValue()};
+  auto it = values_.find(V);
+  if (it != values_.end())
+    return it->second;
+  // not reached yet
+  if (dynamic_cast<Instruction *>(V) || dynamic_cast<Argument *>(V) ||
+      dynamic_cast<Function *>(V))
+    return LatticeVal();
+  return {LatticeVal::Overdefined, 0};
+}
+
+void IPSCCPPass::mergeIn(Value *V, LatticeVal L) {
+  if (L.state == LatticeVal::Unknown)
+    return;
+  LatticeVal &cur = values_[V];
+  if (cur.state == LatticeVal::Overdefined)
+    return;
+  if (cur.state == LatticeVal::Unknown)
+    cur = L;
+  else if (L.state == LatticeVal::Overdefined || L.value != cur.value)
+    cur.state = LatticeVal::Overdefined;
+  else
+    return;
+  solverChanged_ = true;
+}
+
+void IPSCCPPass::markExecutable(BasicBlock *BB) {
+  if (executable_.insert(BB).second)
+    solverChanged_ = true;
+}
+
+void IPSCCPPass::visit(Instruction *I) {
+  const LatticeVal overdefined{LatticeVal::Overdefined, 0};
+
+  if (I->isBinaryOp()) {
+    LatticeVal L = getValue(I->getOperand(0));
+    LatticeVal R = getValue(I->getOperand(1));
+    if (L.state == LatticeVal::Overdefined ||
+        R.state == LatticeVal::Overdefined) {
+      mergeIn(I, overdefined);
+    } else if (L.state == LatticeVal::Constant &&
+               R.state == LatticeVal::Constant) {
+      Type *i32 = Type::getInt32Ty();
+      ConstantInt *C = ConstantFoldBinaryOp(I->getOpcode(),
+                                            ConstantInt::get(i32, L.value),
+                                            ConstantInt::get(i32, R.value));
+      mergeIn(I, C ? LatticeVal{LatticeVal::Constant, C->getValue()}
+                   : overdefined);
+    }
+    return;
+  }
+
+  switch (I->getOpcode()) {
+  case Opcode::Select: {
+    LatticeVal cond = getValue(I->getOperand(0));
+    if (cond.state == LatticeVal::Constant) {
+      mergeIn(I, getValue(I->getOperand(cond.value ? 1 : 2)));
+    } else if (cond.state == LatticeVal::Overdefined) {
+      mergeIn(I, getValue(I->getOperand(1)));
+      mergeIn(I, getValue(I->getOperand(2)));
+    }
+    break;
+  }
+  case Opcode::Load:
+    if (isTrackedSlot(I->getOperand(0)))
+      mergeIn(I, getValue(I->getOperand(0)));
+    else
+      mergeIn(I, overdefined);
+    break;
+  case Opcode::Store:
+    if (isTrackedSlot(I->getOperand(1)))
+      mergeIn(I->getOperand(1), getValue(I->getOperand(0)));
+    break;
+  case Opcode::Call: {
+    auto *callee = dynamic_cast<Function *>(I->getOperand(0));
+    if (!callee || !tracked_.count(callee)) {
+      mergeIn(I, overdefined);
+      break;
+    }
+    markExecutable(callee->getBasicBlockList().front());
+    for (unsigned i = 1; i < I->getNumOperands(); ++i)
+      mergeIn(callee->getArgs()[i - 1], getValue(I->getOperand(i)));
+    mergeIn(I, getValue(callee));
+    break;
+  }
+  case Opcode::Ret:
+    if (I->getNumOperands() > 0)
+      mergeIn(I->getParent()->getParent(), getValue(I->getOperand(0)));
+    break;
+  case Opcode::Br: {
+    LatticeVal cond = getValue(I->getOperand(0));
+    if (cond.state == LatticeVal::Constant) {
+      markExecutable(
+          static_cast<BasicBlock *>(I->getOperand(cond.value ? 1 : 2)));
+    } else if (cond.state == LatticeVal::Overdefined) {
+      markExecutable(static_cast<BasicBlock *>(I->getOperand(1)));
+      markExecutable(static_cast<BasicBlock *>(I->getOperand(2)));
+    }
+    break;
+  }
+  case Opcode::Jmp:
+    markExecutable(static_cast<BasicBlock *>(I->getOperand(0)));
+    break;
+  default:
+    mergeIn(I, overdefined);
+    break;
+  }
+}
+
+void IPSCCPPass::solve(Module &M) {
+  AA_ = AliasAnalysis();
+  values_.clear();
+  executable_.clear();
+  tracked_.clear();
+
+  for (Function *F : M.getFunctionList()) {
+    if (F->isDeclaration())
+      continue;
+    std::vector<Instruction *> calls;
+    if (F->getName() != "main" && collectCallSites(F, calls) &&
+        !calls.empty()) {
+      tracked_.insert(F);
+      continue;
+    }
+    // called from outside: nothing is known about the arguments
+    for (Argument *arg : F->getArgs())
+      values_[arg] = {LatticeVal::Overdefined, 0};
+    executable_.insert(F->getBasicBlockList().front());
+  }
+
+  // lattice values only move up, so this terminates
+  do {
+    solverChanged_ = false;
+    for (Function *F : M.getFunctionList())
+      for (BasicBlock *BB : F->getBasicBlockList())
+        if (executable_.count(BB))
+          for (auto &I : BB->getInstList())
+            visit(I.get());
+  } while (solverChanged_);
+}
+
+bool IPSCCPPass::rewrite(Module &M) {
+  Type *i32 = Type::getInt32Ty();
+  bool changed = false;
+  for (Function *F : M.getFunctionList()) {
+    for (BasicBlock *BB : F->getBasicBlockList()) {
+      if (!executable_.count(BB))
+        continue;
+      auto &instList = BB->getInstList();
+      for (auto it = instList.begin(); it != instList.end();) {
+        Instruction *I = (it++)->get();
+        if (I->getOpcode() == Opcode::Br) {
+          // SimplifyCFG folds the branch and drops the dead side
+          LatticeVal cond = getValue(I->getOperand(0));
+          if (cond.state == LatticeVal::Constant &&
+              !dynamic_cast<ConstantInt *>(I->getOperand(0))) {
+            I->setOperand(0, ConstantInt::get(i32, cond.value));
+            changed = true;
+          }
+          continue;
+        }
+        if (!I->isBinaryOp() && I->getOpcode() != Opcode::Select &&
+            I->getOpcode() != Opcode::Load && I->getOpcode() != Opcode::Call)
+          continue;
+        LatticeVal L = getValue(I);
+        if (L.state != LatticeVal::Constant || I->use_empty())
+          continue;
+        I->replaceAllUsesWith(ConstantInt::get(i32, L.value));
+        // the call itself may still have side effects
+        if (I->getOpcode() != Opcode::Call)
+          I->eraseFromParent();
+        changed = true;
+      }
+    }
+
+    if (!tracked_.count(F))
+      continue;
+    for (Argument *arg : F->getArgs()) {
+      LatticeVal L = getValue(arg);
+      if (L.state == LatticeVal::Constant && !arg->use_empty()) {
+        arg->replaceAllUsesWith(ConstantInt::get(i32, L.value));
+        changed = true;
+      }
+    }
+  }
+  return changed;
+}
+
+bool IPSCCPPass::propagate(Module &M) {
+  solve(M);
+  return rewrite(M);
+}
+
+//===----------------------------------------------------------------------===//
+// Function specialization
+//
+
+unsigned IPSCCPPass::getSpecializationBonus(Function *F, unsigned ArgNo) {
+  Argument *arg = F->getArgs()[ArgNo];
+  if (!arg->getType()->isIntegerTy())
+    return 0;
+
+  // the argument is spilled to a slot in the entry block; when that is the
+  // slot's only store, every load of the slot reads the argument
+  std::vector<Value *> copies{arg};
+  for (Use *U = arg->use_begin(); U != arg->use_end(); U = U->getNext()) {
+    auto *store = static_cast<Instruction *>(U->getUser());
+    if (store->getOpcode() != Opcode::Store || store->getOperand(0) != arg ||
+        !isTrackedSlot(store->getOperand(1)))
+      continue;
+    Value *slot = store->getOperand(1);
+    std::vector<Value *> loads;
+    bool singleStore = true;
+    for (Use *S = slot->use_begin(); S != slot->use_end(); S = S->getNext()) {
+      auto *user = static_cast<Instruction *>(S->getUser());
+      if (user->getOpcode() == Opcode::Load)
+        loads.push_back(user);
+      else if (user != store)
+        singleStore = false;
+    }
+    if (singleStore)
+      copies.insert(copies.end(), loads.begin(), loads.end());
+  }
+
+  // instructions whose operands all become constant, and whether one of
+  // them decides a branch
+  std::unordered_set<Value *> folded(copies.begin(), copies.end());
+  std::vector<Value *> worklist(copies.begin(), copies.end());
+  unsigned bonus = 0;
+  bool decidesBranch = false;
+  while (!worklist.empty()) {
+    Value *V = worklist.back();
+    worklist.pop_back();
+    for (Use *U = V->use_begin(); U != V->use_end(); U = U->getNext()) {
+      auto *user = static_cast<Instruction *>(U->getUser());
+      if (user->getOpcode() == Opcode::Br)
+        decidesBranch = true;
+      if (!user->isBinaryOp() || folded.count(user))
+        continue;
+      auto isFolded = [&](Value *Op) {
+        return folded.count(Op) || dynamic_cast<ConstantInt *>(Op);
+      };
+      if (isFolded(user->getOperand(0)) && isFolded(user->getOperand(1))) {
+        folded.insert(user);
+        worklist.push_back(user);
+        ++bonus;
+      }
+    }
+  }
+  return decidesBranch ? bonus : 0;
+}
+
+/// \p F contains a loop or calls itself
+static bool loopsOrRecurses(Function *F) {
+  DominatorTree DT(*F);
+  LoopInfo LI(*F, DT);
+  if (!LI.empty())
+    return true;
+  for (BasicBlock *BB : F->getBasicBlockList())
+    for (auto &I : BB->getInstList())
+      if (I->getOpcode() == Opcode::Call && I->getOperand(0) == F)
+        return true;
+  return false;
+}
+
+/// \p A is laid out after \p B, so it may call functions defined by \p B
+static bool comesAfter(Module &M, Function *A, Function *B) {
+  for (Function *F : M.getFunctionList()) {
+    if (F == A)
+      return false;
+    if (F == B)
+      return true;
+  }
+  return false;
+}
+
+bool IPSCCPPass::specialize(Module &M) {
+  using SpecializationKey =
+      std::pair<Function *, std::vector<std::pair<unsigned, int32_t>>>;
+  std::map<SpecializationKey, Function *> clones;
+  std::unordered_map<Function *, bool> hotCallee;
+  bool changed = false;
+
+  // clones are inserted into the list while walking it
+  std::vector<Function *> functions(M.getFunctionList().begin(),
+                                    M.getFunctionList().end());
+  for (Function *caller : functions) {
+    if (caller->isDeclaration())
+      continue;
+    std::vector<Instruction *> calls;
+    for (BasicBlock *BB : caller->getBasicBlockList())
+      for (auto &I : BB->getInstList())
+        if (I->getOpcode() == Opcode::Call && executable_.count(BB))
+          calls.push_back(I.get());
+    if (calls.empty())
+      continue;
+
+    DominatorTree DT(*caller);
+    LoopInfo LI(*caller, DT);
+    for (Instruction *call : calls) {
+      auto *callee = dynamic_cast<Function *>(call->getOperand(0));
+      if (!callee || !tracked_.count(callee) ||
+          !comesAfter(M, caller, callee))
+        continue;
+      unsigned size = getInstructionCount(callee);
+      if (size > MaxSpecializationSize)
+        continue;
+
+      SpecializationKey key{callee, {}};
+      for (unsigned i = 1; i < call->getNumOperands(); ++i) {
+        auto *C = dynamic_cast<ConstantInt *>(call->getOperand(i));
+        if (C && getSpecializationBonus(callee, i - 1) > 0)
+          key.second.emplace_back(i - 1, C->getValue());
+      }
+      if (key.second.empty())
+        continue;
+
+      auto cached = hotCallee.find(callee);
+      if (cached == hotCallee.end())
+        cached = hotCallee.emplace(callee, loopsOrRecurses(callee)).first;
+      if (!LI.getLoopFor(call->getParent()) && !cached->second)
+        continue;
+
+      Function *&clone = clones[key];
+      if (!clone) {
+        if (numSpecializations_[callee] >= MaxSpecializationsPerFunction ||
+            specializedSize_ + size > SpecializationBudget) {
+          clones.erase(key);
+          continue;
+        }
+        std::string name;
+        unsigned n = numSpecializations_[callee]++;
+        do
+          name = callee->getName() + "_spec" + std::to_string(n++);
+        while (M.getFunction(name));
+
+        ValueMap VMap;
+        clone = cloneFunction(callee, name, M, VMap);
+        for (auto &[argNo, value] : key.second)
+          clone->getArgs()[argNo]->replaceAllUsesWith(
+              ConstantInt::get(Type::getInt32Ty(), value));
+        specializedSize_ += size;
+      }
+      call->setOperand(0, clone);
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+bool IPSCCPPass::run(Module &M) {
+  bool changed = propagate(M);
+  for (unsigned round = 0; round < MaxSpecializationRounds; ++round) {
+    if (!specialize(M))
+      break;
+    propagate(M);
+    changed = true;
+  }
+  return changed;
+}
+
+} // namespace nanocc
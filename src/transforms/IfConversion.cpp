@@ -0,0 +1,214 @@
+#include "nanocc/transforms/IfConversion.h"
+#include "nanocc/ir/BasicBlock.h"
+#include "nanocc/ir/Constant.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/GlobalVariable.h"
+#include "nanocc/ir/IRBuilder.h"
+#include "nanocc/ir/Instruction.h"
+#include "nanocc/transforms/LoopUtils.h"
+#include <algorithm>
+#include <utility>
+
+namespace nanocc {
+
+using Opcode = Instruction::Opcode;
+
+/// Instructions a side may have besides its jump
+static constexpr unsigned MaxArmSize = 8;
+
+namespace {
+
+/// The last value a side stores to each address, in order of first store
+using StoreList = std::vector<std::pair<Value *, Value *>>;
+
+} // namespace
+
+static void addStore(StoreList &Stores, Value *Ptr, Value *V) {
+  for (auto &[ptr, value] : Stores) {
+    if (ptr == Ptr) {
+      value = V;
+      return;
+    }
+  }
+  Stores.emplace_back(Ptr, V);
+}
+
+static Value *findStore(const StoreList &Stores, Value *Ptr) {
+  for (auto &[ptr, value] : Stores)
+    if (ptr == Ptr)
+      return value;
+  return nullptr;
+}
+
+/// \p BB is entered only from \p Head and jumps on unconditionally
+static bool isArm(BasicBlock *BB, BasicBlock *Head) {
+  return BB != Head && BB->getPredecessors().size() == 1 &&
+         BB->getTerminator()->getOpcode() == Opcode::Jmp;
+}
+
+static BasicBlock *getJumpTarget(BasicBlock *BB) {
+  return static_cast<BasicBlock *>(BB->getTerminator()->getOperand(0));
+}
+
+bool IfConversionPass::isSafeAddress(Value *Ptr) {
+  // whole locals and globals are always valid to access
+  auto *I = dynamic_cast<Instruction *>(Ptr);
+  if (dynamic_cast<GlobalVariable *>(Ptr) ||
+      (I && I->getOpcode() == Opcode::Alloc))
+    return true;
+  return std::find(accessed_.begin(), accessed_.end(), Ptr) != accessed_.end();
+}
+
+bool IfConversionPass::canSpeculate(BasicBlock *Arm) {
+  if (Arm->getInstList().size() > MaxArmSize + 1)
+    return false;
+  bool seenStore = false;
+  for (auto &I : Arm->getInstList()) {
+    switch (I->getOpcode()) {
+    case Opcode::Jmp:
+    case Opcode::GetElemPtr:
+    case Opcode::GetPtr:
+      break;
+    case Opcode::Div:
+    case Opcode::Mod: {
+      auto *C = dynamic_cast<ConstantInt *>(I->getOperand(1));
+      if (!C || C->getValue() == 0)
+        return false;
+      break;
+    }
+    case Opcode::Load:
+      // the load would no longer see the store before it
+      if (seenStore || !isSafeAddress(I->getOperand(0)))
+        return false;
+      break;
+    case Opcode::Store: {
+      // checked with the other side in convert()
+      auto *ptr = dynamic_cast<Instruction *>(I->getOperand(1));
+      if (ptr && ptr->getParent() == Arm)
+        return false;
+      seenStore = true;
+      break;
+    }
+    default:
+      if (!I->isBinaryOp() && I->getOpcode() != Opcode::Select)
+        return false;
+      break;
+    }
+  }
+  return true;
+}
+
+bool IfConversionPass::convert(BasicBlock *Head) {
+  Instruction *br = Head->getTerminator();
+  if (!br || br->getOpcode() != Opcode::Br)
+    return false;
+  Value *cond = br->getOperand(0);
+  auto *T = static_cast<BasicBlock *>(br->getOperand(1));
+  auto *F = static_cast<BasicBlock *>(br->getOperand(2));
+  if (T == F)
+    return false;
+
+  // a missing side is the edge straight to the join block
+  BasicBlock *armT = nullptr, *armF = nullptr, *join = nullptr;
+  if (isArm(T, Head) && isArm(F, Head) &&
+      getJumpTarget(T) == getJumpTarget(F)) {
+    armT = T;
+    armF = F;
+    join = getJumpTarget(T);
+  } else if (isArm(T, Head) && getJumpTarget(T) == F) {
+    armT = T;
+    join = F;
+  } else if (isArm(F, Head) && getJumpTarget(F) == T) {
+    armF = F;
+    join = T;
+  } else {
+    return false;
+  }
+  if (join == Head)
+    return false;
+
+  accessed_.clear();
+  for (auto &I : Head->getInstList()) {
+    if (I->getOpcode() == Opcode::Load)
+      accessed_.push_back(I->getOperand(0));
+    else if (I->getOpcode() == Opcode::Store)
+      accessed_.push_back(I->getOperand(1));
+  }
+  if ((armT && !canSpeculate(armT)) || (armF && !canSpeculate(armF)))
+    return false;
+
+  StoreList storesT, storesF;
+  std::vector<Value *> ptrs;
+  for (auto [arm, stores] : {std::make_pair(armT, &storesT),
+                             std::make_pair(armF, &storesF)}) {
+    if (!arm)
+      continue;
+    for (auto &I : arm->getInstList()) {
+      if (I->getOpcode() != Opcode::Store)
+        continue;
+      Value *ptr = I->getOperand(1);
+      addStore(*stores, ptr, I->getOperand(0));
+      if (std::find(ptrs.begin(), ptrs.end(), ptr) == ptrs.end())
+        ptrs.push_back(ptr);
+    }
+  }
+  for (size_t i = 0; i < ptrs.size(); ++i) {
+    // stored on one side only: the other side now stores the old value
+    bool both = findStore(storesT, ptrs[i]) && findStore(storesF, ptrs[i]);
+    if (!both && !isSafeAddress(ptrs[i]))
+      return false;
+    for (size_t j = 0; j < i; ++j)
+      if (AA_.alias(ptrs[i], ptrs[j]) != AliasResult::NoAlias)
+        return false;
+  }
+
+  // both sides run in Head, then each word gets the value of the side taken
+  for (BasicBlock *arm : {armT, armF}) {
+    if (!arm)
+      continue;
+    std::vector<Instruction *> insts;
+    for (auto &I : arm->getInstList())
+      if (I->getOpcode() != Opcode::Store && !I->isTerminator())
+        insts.push_back(I.get());
+    for (Instruction *I : insts)
+      moveBefore(I, br);
+  }
+  IRBuilder builder;
+  builder.setInsertPoint(br);
+  for (Value *ptr : ptrs) {
+    Value *trueVal = findStore(storesT, ptr);
+    Value *falseVal = findStore(storesF, ptr);
+    if (!trueVal)
+      trueVal = builder.createLoad(ptr);
+    if (!falseVal)
+      falseVal = builder.createLoad(ptr);
+    builder.createStore(builder.createSelect(cond, trueVal, falseVal), ptr);
+  }
+  builder.createJump(join);
+  br->dropAllReferences();
+  br->eraseFromParent();
+  if (armT)
+    armT->eraseFromParent();
+  if (armF)
+    armF->eraseFromParent();
+  return true;
+}
+
+bool IfConversionPass::run(Function &F) {
+  bool changed = false;
+  bool localChanged = true;
+  // converting a block erases its successors, start over after each one
+  while (localChanged) {
+    localChanged = false;
+    AA_ = AliasAnalysis();
+    for (BasicBlock *BB : F.getBasicBlockList()) {
+      if (convert(BB)) {
+        localChanged = changed = true;
+        break;
+      }
+    }
+  }
+  return changed;
+}
+
+} // namespace nanocc
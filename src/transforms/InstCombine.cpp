@@ -0,0 +1,455 @@
+#include "nanocc/transforms/InstCombine.h"
+#include "nanocc/ir/BasicBlock.h"
+#include "nanocc/ir/Constant.h"
+#include "nanocc/ir/ConstantFold.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/IRBuilder.h"
+#include "nanocc/ir/Instruction.h"
+#include "nanocc/ir/Type.h"
+#include "nanocc/ir/Value.h"
+#include <cstdint>
+#include <utility>
+
+namespace nanocc {
+
+using Opcode = Instruction::Opcode;
+
+static ConstantInt *getInt(int32_t v) {
+  return ConstantInt::get(Type::getInt32Ty(), v);
+}
+
+static bool isConstValue(Value *V, int32_t val) {
+  auto *C = dynamic_cast<ConstantInt *>(V);
+  return C && C->getValue() == val;
+}
+
+static Instruction *asOpcode(Value *V, Opcode op) {
+  auto *I = dynamic_cast<Instruction *>(V);
+  return (I && I->getOpcode() == op) ? I : nullptr;
+}
+
+/// Match `sub 0, X` and return X
+static Value *matchNeg(Value *V) {
+  if (auto *I = asOpcode(V, Opcode::Sub))
+    if (isConstValue(I->getOperand(0), 0))
+      return I->getOperand(1);
+  return nullptr;
+}
+
+static bool isPowerOf2(uint32_t v) { return v && !(v & (v - 1)); }
+
+static int log2u(uint32_t v) {
+  int k = 0;
+  while (v >>= 1)
+    ++k;
+  return k;
+}
+
+/// Value is known to be 0 or 1
+static bool isBoolean(Value *V) {
+  if (auto *C = dynamic_cast<ConstantInt *>(V))
+    return C->getValue() == 0 || C->getValue() == 1;
+  auto *I = dynamic_cast<Instruction *>(V);
+  if (!I)
+    return false;
+  if (I->isComparison())
+    return true;
+  if (I->getOpcode() == Opcode::And || I->getOpcode() == Opcode::Or ||
+      I->getOpcode() == Opcode::Xor)
+    return isBoolean(I->getOperand(0)) && isBoolean(I->getOperand(1));
+  return false;
+}
+
+/// Sign bit of the value is known to be clear
+static bool isKnownNonNegative(Value *V, unsigned depth = 0) {
+  if (auto *C = dynamic_cast<ConstantInt *>(V))
+    return C->getValue() >= 0;
+  auto *I = dynamic_cast<Instruction *>(V);
+  if (!I || depth > 4)
+    return false;
+  switch (I->getOpcode()) {
+  case Opcode::And:
+    return isKnownNonNegative(I->getOperand(0), depth + 1) ||
+           isKnownNonNegative(I->getOperand(1), depth + 1);
+  case Opcode::Or:
+  case Opcode::Xor:
+  case Opcode::Div:
+    return isKnownNonNegative(I->getOperand(0), depth + 1) &&
+           isKnownNonNegative(I->getOperand(1), depth + 1);
+  case Opcode::Mod:
+  case Opcode::Sar:
+    return isKnownNonNegative(I->getOperand(0), depth + 1);
+  case Opcode::Shr: {
+    auto *C = dynamic_cast<ConstantInt *>(I->getOperand(1));
+    return (C && (C->getValue() & 31) != 0) ||
+           isKnownNonNegative(I->getOperand(0), depth + 1);
+  }
+  default:
+    return I->isComparison();
+  }
+}
+
+static Opcode inversePredicate(Opcode op) {
+  switch (op) {
+  case Opcode::Lt:
+    return Opcode::Ge;
+  case Opcode::Ge:
+    return Opcode::Lt;
+  case Opcode::Gt:
+    return Opcode::Le;
+  case Opcode::Le:
+    return Opcode::Gt;
+  case Opcode::Eq:
+    return Opcode::Ne;
+  case Opcode::Ne:
+    return Opcode::Eq;
+  default:
+    assert(false && "Not a comparison");
+    return op;
+  }
+}
+
+/// Predicate that gives the same result with swapped operands
+static Opcode swappedPredicate(Opcode op) {
+  switch (op) {
+  case Opcode::Lt:
+    return Opcode::Gt;
+  case Opcode::Gt:
+    return Opcode::Lt;
+  case Opcode::Le:
+    return Opcode::Ge;
+  case Opcode::Ge:
+    return Opcode::Le;
+  default:
+    return op;
+  }
+}
+
+static bool isTriviallyDead(Instruction *I) {
+  return !I->getType()->isVoidTy() && I->use_empty() &&
+         I->getOpcode() != Opcode::Call;
+}
+
+//===--------------------------------------------------------------------===//
+// Worklist management
+//
+
+void InstCombinePass::push(Value *V) {
+  auto *I = dynamic_cast<Instruction *>(V);
+  if (I && inWorklist_.insert(I).second)
+    worklist_.push_back(I);
+}
+
+void InstCombinePass::pushUsers(Value *V) {
+  for (Use *U = V->use_begin(); U != V->use_end(); U = U->getNext())
+    push(U->getUser());
+}
+
+void InstCombinePass::eraseInst(Instruction *I) {
+  std::vector<Value *> operands;
+  for (unsigned i = 0; i < I->getNumOperands(); ++i)
+    operands.push_back(I->getOperand(i));
+
+  inWorklist_.erase(I);
+  I->eraseFromParent();
+
+  // operands may have become dead
+  for (Value *Op : operands)
+    push(Op);
+}
+
+void InstCombinePass::replaceInst(Instruction *I, Value *V) {
+  pushUsers(I);
+  if (V == I) {
+    // modified in place
+    push(I);
+    return;
+  }
+  I->replaceAllUsesWith(V);
+  push(V);
+  eraseInst(I);
+}
+
+//===--------------------------------------------------------------------===//
+// Combines
+//
+
+Value *InstCombinePass::visitBinaryOp(Instruction *I) {
+  Value *L = I->getOperand(0);
+  Value *R = I->getOperand(1);
+  auto *CL = dynamic_cast<ConstantInt *>(L);
+  auto *CR = dynamic_cast<ConstantInt *>(R);
+  if (CL && CR)
+    return ConstantFoldBinaryOp(I->getOpcode(), CL, CR);
+
+  IRBuilder builder;
+  builder.setInsertPoint(I);
+
+  // canonicalize constants to the right hand side
+  if (CL) {
+    if (I->isCommutative()) {
+      I->setOperand(0, R);
+      I->setOperand(1, L);
+      return I;
+    }
+    if (I->isComparison())
+      return builder.createBinaryOp(swappedPredicate(I->getOpcode()), R, L);
+  }
+
+  switch (I->getOpcode()) {
+  case Opcode::Add: {
+    if (isConstValue(R, 0))
+      return L;
+    if (Value *X = matchNeg(R)) // x + (0 - y) -> x - y
+      return builder.createBinaryOp(Opcode::Sub, L, X);
+    if (Value *X = matchNeg(L)) // (0 - x) + y -> y - x
+      return builder.createBinaryOp(Opcode::Sub, R, X);
+    break;
+  }
+  case Opcode::Sub: {
+    if (L == R)
+      return getInt(0);
+    if (CR) {
+      if (CR->getValue() == 0)
+        return L;
+      // x - c -> x + (-c), so that reassociation only has to handle add
+      uint32_t neg = 0u - static_cast<uint32_t>(CR->getValue());
+      return builder.createBinaryOp(Opcode::Add, L,
+                                    getInt(static_cast<int32_t>(neg)));
+    }
+    if (Value *X = matchNeg(R)) {
+      if (isConstValue(L, 0)) // 0 - (0 - x) -> x
+        return X;
+      return builder.createBinaryOp(Opcode::Add, L, X);
+    }
+    break;
+  }
+  case Opcode::Mul:
+    return visitMul(I);
+  case Opcode::Div: {
+    if (isConstValue(R, 1))
+      return L;
+    if (isConstValue(R, -1))
+      return builder.createBinaryOp(Opcode::Sub, getInt(0), L);
+    break;
+  }
+  case Opcode::Mod: {
+    if (isConstValue(R, 1) || isConstValue(R, -1))
+      return getInt(0);
+    // the sign of the result follows the dividend, so x % -2^k == x % 2^k
+    if (CR && CR->getValue() != INT32_MIN) {
+      uint32_t abs = static_cast<uint32_t>(
+          CR->getValue() < 0 ? -CR->getValue() : CR->getValue());
+      if (isPowerOf2(abs) && isKnownNonNegative(L))
+        return builder.createBinaryOp(
+            Opcode::And, L, getInt(static_cast<int32_t>(abs - 1)));
+    }
+    break;
+  }
+  case Opcode::And: {
+    if (isConstValue(R, 0))
+      return getInt(0);
+    if (isConstValue(R, -1) || L == R)
+      return L;
+    break;
+  }
+  case Opcode::Or: {
+    if (isConstValue(R, 0) || L == R)
+      return L;
+    if (isConstValue(R, -1))
+      return getInt(-1);
+    break;
+  }
+  case Opcode::Xor: {
+    if (isConstValue(R, 0))
+      return L;
+    if (L == R)
+      return getInt(0);
+    // (x ^ c) ^ c -> x
+    if (auto *X = asOpcode(L, Opcode::Xor))
+      if (CR && isConstValue(X->getOperand(1), CR->getValue()))
+        return X->getOperand(0);
+    break;
+  }
+  case Opcode::Shl:
+  case Opcode::Shr:
+  case Opcode::Sar: {
+    if (isConstValue(R, 0))
+      return L;
+    if (isConstValue(L, 0))
+      return getInt(0);
+    break;
+  }
+  default:
+    if (I->isComparison())
+      return visitCompare(I);
+    break;
+  }
+  return nullptr;
+}
+
+Value *InstCombinePass::visitMul(Instruction *I) {
+  Value *L = I->getOperand(0);
+  auto *CR = dynamic_cast<ConstantInt *>(I->getOperand(1));
+  if (!CR)
+    return nullptr;
+
+  int32_t c = CR->getValue();
+  if (c == 0)
+    return getInt(0);
+  if (c == 1)
+    return L;
+
+  IRBuilder builder;
+  builder.setInsertPoint(I);
+  if (c == -1)
+    return builder.createBinaryOp(Opcode::Sub, getInt(0), L);
+
+  // Only a single shift is a win: the backend keeps every IR value in a
+  // stack slot, so a shl+add pair costs more than one mul on RV32IM.
+  uint32_t u = static_cast<uint32_t>(c);
+  if (isPowerOf2(u))
+    return builder.createBinaryOp(Opcode::Shl, L, getInt(log2u(u)));
+  return nullptr;
+}
+
+Value *InstCombinePass::visitCompare(Instruction *I) {
+  Opcode op = I->getOpcode();
+  Value *L = I->getOperand(0);
+  Value *R = I->getOperand(1);
+
+  if (L == R)
+    return getInt(op == Opcode::Eq || op == Opcode::Le || op == Opcode::Ge);
+
+  if (!isBoolean(L) || !(op == Opcode::Eq || op == Opcode::Ne))
+    return nullptr;
+
+  // `ne b, 0` and `eq b, 1` are b itself
+  if ((op == Opcode::Ne && isConstValue(R, 0)) ||
+      (op == Opcode::Eq && isConstValue(R, 1)))
+    return L;
+
+  // `eq b, 0` and `ne b, 1` are the logical negation of b
+  if ((op == Opcode::Eq && isConstValue(R, 0)) ||
+      (op == Opcode::Ne && isConstValue(R, 1))) {
+    IRBuilder builder;
+    builder.setInsertPoint(I);
+    auto *cmp = dynamic_cast<Instruction *>(L);
+    if (cmp && cmp->isComparison())
+      return builder.createBinaryOp(inversePredicate(cmp->getOpcode()),
+                                    cmp->getOperand(0), cmp->getOperand(1));
+    return builder.createBinaryOp(Opcode::Xor, L, getInt(1));
+  }
+  return nullptr;
+}
+
+Value *InstCombinePass::visitSelect(Instruction *I) {
+  Value *cond = I->getOperand(0);
+  Value *T = I->getOperand(1);
+  Value *F = I->getOperand(2);
+  if (auto *C = dynamic_cast<ConstantInt *>(cond))
+    return C->getValue() ? T : F;
+  if (T == F)
+    return T;
+
+  // select b, 1, 0 -> b and select b, 0, 1 -> !b for a 0/1 condition
+  if (isBoolean(cond) && isConstValue(T, 1) && isConstValue(F, 0))
+    return cond;
+  if (isBoolean(cond) && isConstValue(T, 0) && isConstValue(F, 1)) {
+    IRBuilder builder;
+    builder.setInsertPoint(I);
+    return builder.createBinaryOp(Opcode::Eq, cond, getInt(0));
+  }
+
+  // drop a redundant `ne x, 0` / `eq x, 0` on the condition, as for branches
+  auto *C = dynamic_cast<Instruction *>(cond);
+  if (C && (C->getOpcode() == Opcode::Ne || C->getOpcode() == Opcode::Eq) &&
+      isConstValue(C->getOperand(1), 0)) {
+    I->setOperand(0, C->getOperand(0));
+    if (C->getOpcode() == Opcode::Eq) {
+      I->setOperand(1, F);
+      I->setOperand(2, T);
+    }
+    push(C);
+    return I;
+  }
+  return nullptr;
+}
+
+bool InstCombinePass::visitBranch(Instruction *I) {
+  bool changed = false;
+  for (;;) {
+    Value *cond = I->getOperand(0);
+    Value *newCond = nullptr;
+    bool invert = false;
+    if (auto *C = dynamic_cast<Instruction *>(cond)) {
+      if (C->getOpcode() == Opcode::Ne && isConstValue(C->getOperand(1), 0)) {
+        newCond = C->getOperand(0); // br (ne x, 0) -> br x
+      } else if (C->getOpcode() == Opcode::Eq &&
+                 isConstValue(C->getOperand(1), 0)) {
+        newCond = C->getOperand(0); // br (eq x, 0), T, F -> br x, F, T
+        invert = true;
+      } else if (C->getOpcode() == Opcode::Xor &&
+                 isConstValue(C->getOperand(1), 1) &&
+                 isBoolean(C->getOperand(0))) {
+        newCond = C->getOperand(0);
+        invert = true;
+      }
+    }
+    if (!newCond)
+      return changed;
+
+    I->setOperand(0, newCond);
+    if (invert) {
+      Value *trueBB = I->getOperand(1);
+      I->setOperand(1, I->getOperand(2));
+      I->setOperand(2, trueBB);
+    }
+    push(cond); // the old condition may be dead now
+    changed = true;
+  }
+}
+
+bool InstCombinePass::run(Function &F) {
+  worklist_.clear();
+  inWorklist_.clear();
+
+  // seed in reverse so that instructions are popped in program order
+  auto &blocks = F.getBasicBlockList();
+  for (auto bbIt = blocks.rbegin(); bbIt != blocks.rend(); ++bbIt) {
+    auto &instList = (*bbIt)->getInstList();
+    for (auto it = instList.rbegin(); it != instList.rend(); ++it)
+      push(it->get());
+  }
+
+  bool changed = false;
+  while (!worklist_.empty()) {
+    Instruction *I = worklist_.back();
+    worklist_.pop_back();
+    if (!inWorklist_.erase(I))
+      continue; // erased after it was queued
+
+    if (isTriviallyDead(I)) {
+      eraseInst(I);
+      changed = true;
+      continue;
+    }
+
+    if (I->isBinaryOp()) {
+      if (Value *V = visitBinaryOp(I)) {
+        replaceInst(I, V);
+        changed = true;
+      }
+    } else if (I->getOpcode() == Opcode::Select) {
+      if (Value *V = visitSelect(I)) {
+        replaceInst(I, V);
+        changed = true;
+      }
+    } else if (I->getOpcode() == Opcode::Br) {
+      changed |= visitBranch(I);
+    }
+  }
+  return changed;
+}
+
+} // namespace nanocc
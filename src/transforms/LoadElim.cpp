@@ -0,0 +1,148 @@
+#include "nanocc/transforms/LoadElim.h"
+#include "nanocc/ir/BasicBlock.h"
+#include "nanocc/ir/Constant.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/Instruction.h"
+#include "nanocc/ir/Type.h"
+#include "nanocc/ir/Value.h"
+#include <algorithm>
+
+namespace nanocc {
+
+using Opcode = Instruction::Opcode;
+
+/// Bound on tracked pointers per program point, keeps long runs of array
+/// initialization stores from turning every alias query quadratic
+static constexpr size_t MaxAvailableValues = 64;
+
+/// A call to a pure function is recorded with itself as key
+static bool isCallEntry(const std::pair<Value *, Value *> &Entry) {
+  return Entry.first == Entry.second;
+}
+
+static bool isPureCall(Instruction *I) {
+  auto *callee = dynamic_cast<Function *>(I->getOperand(0));
+  return callee && !I->getType()->isVoidTy() &&
+         callee->getMemoryEffects().isPure();
+}
+
+static bool isSameValue(Value *A, Value *B) {
+  auto *CA = dynamic_cast<ConstantInt *>(A);
+  auto *CB = dynamic_cast<ConstantInt *>(B);
+  return A == B || (CA && CB && CA->getValue() == CB->getValue());
+}
+
+Value *LoadElimPass::lookup(const AvailableValues &Avail, Value *Ptr) {
+  for (auto it = Avail.rbegin(); it != Avail.rend(); ++it) {
+    if (isCallEntry(*it))
+      continue;
+    if (it->first == Ptr || AA_.alias(it->first, Ptr) == AliasResult::MustAlias)
+      return it->second;
+  }
+  return nullptr;
+}
+
+Value *LoadElimPass::lookupCall(const AvailableValues &Avail,
+                                Instruction *Call) {
+  for (auto it = Avail.rbegin(); it != Avail.rend(); ++it) {
+    if (!isCallEntry(*it))
+      continue;
+    auto *other = static_cast<Instruction *>(it->first);
+    if (other->getNumOperands() != Call->getNumOperands())
+      continue;
+    bool same = true;
+    for (unsigned i = 0; i < Call->getNumOperands() && same; ++i)
+      same = isSameValue(other->getOperand(i), Call->getOperand(i));
+    if (same)
+      return other;
+  }
+  return nullptr;
+}
+
+/// Drop every entry that \p I may overwrite
+void LoadElimPass::clobber(AvailableValues &Avail, Instruction *I) {
+  Avail.erase(std::remove_if(Avail.begin(), Avail.end(),
+                             [&](const auto &Entry) {
+                               return !isCallEntry(Entry) &&
+                                      (AA_.getModRefInfo(I, Entry.first) & Mod);
+                             }),
+              Avail.end());
+}
+
+LoadElimPass::AvailableValues LoadElimPass::mergePredecessors(BasicBlock *BB) {
+  std::vector<BasicBlock *> preds = BB->getPredecessors();
+  if (preds.empty())
+    return {};
+  for (BasicBlock *pred : preds)
+    if (!blockOut_.count(pred))
+      return {}; // back edge, nothing is known yet
+
+  AvailableValues result = blockOut_[preds[0]];
+  for (size_t i = 1; i < preds.size(); ++i) {
+    const AvailableValues &other = blockOut_[preds[i]];
+    result.erase(std::remove_if(result.begin(), result.end(),
+                                [&](const auto &Entry) {
+                                  return std::find(other.begin(), other.end(),
+                                                   Entry) == other.end();
+                                }),
+                 result.end());
+  }
+  return result;
+}
+
+bool LoadElimPass::processBlock(BasicBlock *BB) {
+  AvailableValues avail = mergePredecessors(BB);
+  bool changed = false;
+
+  auto &instList = BB->getInstList();
+  for (auto it = instList.begin(); it != instList.end();) {
+    Instruction *I = (it++)->get();
+    switch (I->getOpcode()) {
+    case Opcode::Load: {
+      Value *ptr = I->getOperand(0);
+      if (Value *V = lookup(avail, ptr)) {
+        I->replaceAllUsesWith(V);
+        I->eraseFromParent();
+        changed = true;
+        continue;
+      }
+      avail.emplace_back(ptr, I);
+      break;
+    }
+    case Opcode::Store:
+      clobber(avail, I);
+      avail.emplace_back(I->getOperand(1), I->getOperand(0));
+      break;
+    case Opcode::Call:
+      if (isPureCall(I)) {
+        if (Value *V = lookupCall(avail, I)) {
+          I->replaceAllUsesWith(V);
+          I->eraseFromParent();
+          changed = true;
+          continue;
+        }
+        avail.emplace_back(I, I);
+        break;
+      }
+      clobber(avail, I);
+      break;
+    default:
+      break;
+    }
+    if (avail.size() > MaxAvailableValues)
+      avail.erase(avail.begin());
+  }
+
+  blockOut_[BB] = std::move(avail);
+  return changed;
+}
+
+bool LoadElimPass::run(Function &F) {
+  blockOut_.clear();
+  bool changed = false;
+  for (BasicBlock *BB : F.getBasicBlockList())
+    changed |= processBlock(BB);
+  return changed;
+}
+
+} // namespace nanocc
@@ -0,0 +1,135 @@
+#include "nanocc/transforms/LoopDeletion.h"
+#include "nanocc/analysis/LoopInfo.h"
+#include "nanocc/ir/BasicBlock.h"
+#include "nanocc/ir/Constant.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/IRBuilder.h"
+#include "nanocc/ir/Instruction.h"
+#include "nanocc/ir/Type.h"
+#include "nanocc/transforms/LoopUtils.h"
+#include <unordered_set>
+#include <vector>
+
+namespace nanocc {
+
+using Opcode = Instruction::Opcode;
+
+/// \p Slot may be loaded on a path from the start of \p BB before it is
+/// stored again. The blocks of \p L are about to go and are passed through.
+static bool isLiveAt(Value *Slot, BasicBlock *BB, Loop *L) {
+  std::unordered_set<BasicBlock *> visited;
+  std::vector<BasicBlock *> worklist{BB};
+  while (!worklist.empty()) {
+    BasicBlock *cur = worklist.back();
+    worklist.pop_back();
+    if (!visited.insert(cur).second)
+      continue;
+    bool killed = false;
+    if (!L->contains(cur)) {
+      for (auto &I : cur->getInstList()) {
+        if (I->getOpcode() == Opcode::Load && I->getOperand(0) == Slot)
+          return true;
+        if (I->getOpcode() == Opcode::Store && I->getOperand(1) == Slot) {
+          killed = true;
+          break;
+        }
+      }
+    }
+    if (!killed)
+      for (BasicBlock *succ : cur->getSuccessors())
+        worklist.push_back(succ);
+  }
+  return false;
+}
+
+bool LoopDeletionPass::runOnLoop(Loop *L) {
+  CountedLoop CL;
+  BasicBlock *preheader = L->getLoopPreheader();
+  if (!L->getSubLoops().empty() || !preheader ||
+      preheader->getTerminator()->getOpcode() != Opcode::Jmp ||
+      !matchCountedLoop(L, AA_, CL))
+    return false;
+
+  std::unordered_set<Value *> stored;
+  // header loads of the induction variable used after the loop, which
+  // read its final value
+  std::vector<Use *> finalUses;
+  for (BasicBlock *BB : L->getBlocks()) {
+    for (auto &I : BB->getInstList()) {
+      if (I->getOpcode() == Opcode::Call)
+        return false;
+      bool isFinal = BB == CL.header && I->getOpcode() == Opcode::Load &&
+                     I->getOperand(0) == CL.slot;
+      for (Use *U = I->use_begin(); U != I->use_end(); U = U->getNext()) {
+        if (L->contains(static_cast<Instruction *>(U->getUser())->getParent()))
+          continue;
+        if (!isFinal)
+          return false;
+        finalUses.push_back(U);
+      }
+      if (I->getOpcode() != Opcode::Store)
+        continue;
+      Value *ptr = I->getOperand(1);
+      auto *slot = dynamic_cast<Instruction *>(ptr);
+      if (!slot || slot->getOpcode() != Opcode::Alloc ||
+          !slot->getType()->getPointerElementType()->isIntegerTy() ||
+          !AA_.isNonEscapingLocal(slot))
+        return false;
+      stored.insert(ptr);
+    }
+  }
+
+  // the loop must terminate: the bound does not change while it runs
+  if (auto *bound = dynamic_cast<Instruction *>(CL.bound)) {
+    if (L->contains(bound->getParent()) &&
+        (bound->getOpcode() != Opcode::Load ||
+         stored.count(bound->getOperand(0)) ||
+         !L->isLoopInvariant(bound->getOperand(0))))
+      return false;
+  }
+
+  bool storeFinal = false;
+  for (Value *slot : stored) {
+    if (!isLiveAt(slot, CL.exit, L))
+      continue;
+    if (slot != CL.slot)
+      return false;
+    storeFinal = true;
+  }
+  int64_t trips = getConstantTripCount(CL);
+  if ((storeFinal || !finalUses.empty()) && trips < 0)
+    return false;
+
+  Instruction *jump = preheader->getTerminator();
+  if (trips >= 0) {
+    int64_t init = static_cast<ConstantInt *>(CL.init)->getValue();
+    auto *finalValue = ConstantInt::get(
+        Type::getInt32Ty(), static_cast<int>(init + trips * CL.step));
+    for (Use *U : finalUses)
+      U->set(finalValue);
+    if (storeFinal) {
+      IRBuilder builder;
+      builder.setInsertPoint(jump);
+      builder.createStore(finalValue, CL.slot);
+    }
+  }
+  jump->setOperand(0, CL.exit);
+
+  for (BasicBlock *BB : L->getBlocks())
+    for (auto &I : BB->getInstList())
+      I->dropAllReferences();
+  std::vector<BasicBlock *> blocks = L->getBlocks();
+  for (BasicBlock *BB : blocks)
+    BB->eraseFromParent();
+  return true;
+}
+
+bool LoopDeletionPass::run(Function &F) {
+  return runOnLoopsUntilFixpoint(F, [&](Loop *L, LoopInfo &) {
+    // deleted loops take their stores with them
+    AA_ = AliasAnalysis();
+    return runOnLoop(L);
+  });
+}
+
+} // namespace nanocc
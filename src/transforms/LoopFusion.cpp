@@ -0,0 +1,268 @@
+#include "nanocc/transforms/LoopFusion.h"
+#include "nanocc/analysis/DependenceAnalysis.h"
+#include "nanocc/analysis/LoopInfo.h"
+#include "nanocc/ir/BasicBlock.h"
+#include "nanocc/ir/Constant.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/GlobalVariable.h"
+#include "nanocc/ir/IRBuilder.h"
+#include "nanocc/ir/Instruction.h"
+#include "nanocc/ir/Type.h"
+#include "nanocc/transforms/LoopUtils.h"
+#include <unordered_set>
+#include <vector>
+
+namespace nanocc {
+
+using Opcode = Instruction::Opcode;
+
+namespace {
+
+/// Memory touched by one of the loops
+struct LoopAccesses {
+  /// int locals and globals, accessed directly
+  std::unordered_set<Value *> scalarsRead, scalarsWritten;
+  std::vector<ArrayAccess> arrays;
+};
+
+} // namespace
+
+static bool isSameValue(Value *A, Value *B) {
+  auto *CA = dynamic_cast<ConstantInt *>(A);
+  auto *CB = dynamic_cast<ConstantInt *>(B);
+  return A == B || (CA && CB && CA->getValue() == CB->getValue());
+}
+
+static bool isDefinedIn(Value *V, Loop *L) {
+  auto *I = dynamic_cast<Instruction *>(V);
+  return I && L->contains(I->getParent());
+}
+
+static bool isScalarSlot(Value *Ptr) {
+  auto *I = dynamic_cast<Instruction *>(Ptr);
+  bool isObject = dynamic_cast<GlobalVariable *>(Ptr) ||
+                  (I && I->getOpcode() == Opcode::Alloc);
+  return isObject && Ptr->getType()->getPointerElementType()->isIntegerTy();
+}
+
+static bool mayModify(Loop *L, Value *Ptr, AliasAnalysis &AA) {
+  for (BasicBlock *BB : L->getBlocks())
+    for (auto &I : BB->getInstList())
+      if ((I->getOpcode() == Opcode::Store ||
+           I->getOpcode() == Opcode::Call) &&
+          (AA.getModRefInfo(I.get(), Ptr) & Mod))
+        return true;
+  return false;
+}
+
+/// Both loops test against the same value on every iteration
+static bool haveSameBound(const CountedLoop &A, const CountedLoop &B,
+                          AliasAnalysis &AA) {
+  if (isSameValue(A.bound, B.bound))
+    return !isDefinedIn(A.bound, A.L) && !isDefinedIn(A.bound, B.L);
+  auto *loadA = dynamic_cast<Instruction *>(A.bound);
+  auto *loadB = dynamic_cast<Instruction *>(B.bound);
+  if (!loadA || !loadB || loadA->getOpcode() != Opcode::Load ||
+      loadB->getOpcode() != Opcode::Load || loadA->getParent() != A.header ||
+      loadB->getParent() != B.header)
+    return false;
+  Value *ptr = loadA->getOperand(0);
+  return ptr == loadB->getOperand(0) && !isDefinedIn(ptr, A.L) &&
+         !isDefinedIn(ptr, B.L) && !mayModify(A.L, ptr, AA) &&
+         !mayModify(B.L, ptr, AA);
+}
+
+/// Sort the memory accesses of \p CL into \p Acc
+/// @return false if the loop calls a function that touches memory, reads
+/// its variable after the increment or defines a value used after it
+static bool collectAccesses(const CountedLoop &CL, DependenceAnalysis &DA,
+                            AliasAnalysis &AA, LoopAccesses &Acc) {
+  for (BasicBlock *BB : CL.L->getBlocks()) {
+    bool afterStep = false;
+    for (auto &I : BB->getInstList()) {
+      for (Use *U = I->use_begin(); U != I->use_end(); U = U->getNext())
+        if (!CL.L->contains(
+                static_cast<Instruction *>(U->getUser())->getParent()))
+          return false;
+      if (I->getOpcode() == Opcode::Call &&
+          !AA.getMemoryEffects(I.get()).isPure())
+        return false;
+      if (I.get() == CL.stepStore) {
+        Acc.scalarsWritten.insert(CL.slot);
+        afterStep = true;
+        continue;
+      }
+      if (I->getOpcode() != Opcode::Load && I->getOpcode() != Opcode::Store)
+        continue;
+      bool isWrite = I->getOpcode() == Opcode::Store;
+      Value *ptr = I->getOperand(isWrite ? 1 : 0);
+      if (ptr == CL.slot && afterStep)
+        return false;
+      if (isScalarSlot(ptr))
+        (isWrite ? Acc.scalarsWritten : Acc.scalarsRead).insert(ptr);
+      else
+        Acc.arrays.push_back(DA.getAccess(I.get()));
+    }
+  }
+  return true;
+}
+
+/// A scalar written by one loop and accessed by the other, other than the
+/// shared induction variable \p Shared; each loop writes its own variable
+static bool haveScalarConflict(const LoopAccesses &A, const LoopAccesses &B,
+                               Value *Shared) {
+  for (Value *slot : A.scalarsWritten)
+    if (slot != Shared &&
+        (B.scalarsRead.count(slot) || B.scalarsWritten.count(slot)))
+      return true;
+  return false;
+}
+
+/// Remove the increment \p StepStore together with its computation
+static void eraseIncrement(Instruction *StepStore) {
+  auto *add = static_cast<Instruction *>(StepStore->getOperand(0));
+  auto *load = static_cast<Instruction *>(add->getOperand(0));
+  StepStore->dropAllReferences();
+  StepStore->eraseFromParent();
+  eraseIfDead(add);
+  eraseIfDead(load);
+}
+
+bool LoopFusionPass::fuse(Loop *First, Loop *Second) {
+  CountedLoop A, B;
+  if (!matchCountedLoop(First, AA_, A) || !matchCountedLoop(Second, AA_, B))
+    return false;
+  BasicBlock *preheader = First->getLoopPreheader();
+  BasicBlock *mid = A.exit;
+  if (!preheader || Second->getLoopPreheader() != mid ||
+      mid->getPredecessors().size() != 1 ||
+      B.body->getPredecessors().size() != 1 || !A.init ||
+      !isSameValue(A.init, B.init) || A.step != B.step ||
+      !haveSameBound(A, B, AA_))
+    return false;
+
+  // between the loops: nothing but the start of the second one
+  for (auto &I : mid->getInstList()) {
+    if (I->isTerminator() || I->getOpcode() == Opcode::Alloc)
+      continue;
+    if (I->getOpcode() != Opcode::Store || I->getOperand(1) != B.slot)
+      return false;
+  }
+  // the test of the second loop is dropped
+  for (auto &I : B.header->getInstList())
+    if (I->getOpcode() == Opcode::Store || I->getOpcode() == Opcode::Call ||
+        I->getOpcode() == Opcode::Alloc)
+      return false;
+
+  DependenceAnalysis depA(First, {A.slot}, AA_);
+  DependenceAnalysis depB(Second, {B.slot}, AA_);
+  LoopAccesses accA, accB;
+  if (!collectAccesses(A, depA, AA_, accA) ||
+      !collectAccesses(B, depB, AA_, accB))
+    return false;
+  Value *shared = A.slot == B.slot ? A.slot : nullptr;
+  // the start of the second loop moves in front of the first one
+  if (!shared)
+    accB.scalarsWritten.insert(B.slot);
+  if (haveScalarConflict(accA, accB, shared) ||
+      haveScalarConflict(accB, accA, shared))
+    return false;
+
+  // both variables hold the same value in the same iteration
+  for (ArrayAccess &access : accB.arrays) {
+    for (AffineExpr &E : access.subscripts) {
+      auto it = E.terms.find(B.slot);
+      if (it == E.terms.end() || shared)
+        continue;
+      E.terms[A.slot] = it->second;
+      E.terms.erase(it);
+    }
+  }
+  std::vector<std::optional<int64_t>> distance;
+  for (const ArrayAccess &a : accA.arrays) {
+    for (const ArrayAccess &b : accB.arrays) {
+      if (!a.isWrite && !b.isWrite)
+        continue;
+      if (a.base != b.base) {
+        Value *ptrA = a.inst->getOperand(a.isWrite ? 1 : 0);
+        Value *ptrB = b.inst->getOperand(b.isWrite ? 1 : 0);
+        if (AA_.alias(ptrA, ptrB) == AliasResult::NoAlias)
+          continue;
+      }
+      switch (depA.getDistance(a, b, distance)) {
+      case DependenceAnalysis::Result::Independent:
+        continue;
+      case DependenceAnalysis::Result::Unknown:
+        return false;
+      case DependenceAnalysis::Result::Dependent:
+        // the second loop must not get there first
+        if (!distance[0] || *distance[0] < 0)
+          return false;
+      }
+    }
+  }
+
+  // the second loop is started along with the first
+  std::vector<Instruction *> midInsts;
+  for (auto &I : mid->getInstList())
+    if (!I->isTerminator())
+      midInsts.push_back(I.get());
+  for (Instruction *I : midInsts) {
+    if (I->getOpcode() == Opcode::Alloc) {
+      hoistToEntry(I);
+    } else if (shared) {
+      I->dropAllReferences();
+      I->eraseFromParent();
+    } else {
+      moveBefore(I, preheader->getTerminator());
+    }
+  }
+
+  // the values of the second header are computed in its body
+  Instruction *bodyStart = B.body->getInstList().front().get();
+  std::vector<Instruction *> headerInsts;
+  for (auto &I : B.header->getInstList())
+    if (!I->isTerminator())
+      headerInsts.push_back(I.get());
+  for (Instruction *I : headerInsts)
+    moveBefore(I, bodyStart);
+
+  // H1 -> B1 -> B2 -> H1, leaving to the exit of the second loop
+  Instruction *headerBr = A.header->getTerminator();
+  for (unsigned i = 1; i < headerBr->getNumOperands(); ++i)
+    if (headerBr->getOperand(i) == mid)
+      headerBr->setOperand(i, B.exit);
+  A.latch->getTerminator()->setOperand(0, B.body);
+  B.latch->getTerminator()->setOperand(0, A.header);
+
+  // one increment per iteration, after both bodies
+  if (!shared) {
+    IRBuilder builder;
+    builder.setInsertPoint(B.latch->getTerminator());
+    Value *next = builder.createBinaryOp(
+        Opcode::Add, builder.createLoad(A.slot),
+        ConstantInt::get(Type::getInt32Ty(), A.step));
+    builder.createStore(next, A.slot);
+  }
+  eraseIncrement(A.stepStore);
+
+  mid->eraseFromParent();
+  B.header->eraseFromParent();
+  eraseIfDead(B.cmp);
+  return true;
+}
+
+bool LoopFusionPass::run(Function &F) {
+  return runOnLoopsUntilFixpoint(F, [&](Loop *L, LoopInfo &LI) {
+    // fusion moves stores and counter slots between loops
+    AA_ = AliasAnalysis();
+    CountedLoop CL;
+    if (!matchCountedLoop(L, AA_, CL) || CL.exit->getSuccessors().size() != 1)
+      return false;
+    BasicBlock *succ = CL.exit->getSuccessors()[0];
+    Loop *next = LI.getLoopFor(succ);
+    return next && next != L && next->getHeader() == succ && fuse(L, next);
+  });
+}
+
+} // namespace nanocc
@@ -0,0 +1,248 @@
+#include "nanocc/transforms/LoopIdiom.h"
+#include "nanocc/analysis/LoopInfo.h"
+#include "nanocc/ir/BasicBlock.h"
+#include "nanocc/ir/Constant.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/IRBuilder.h"
+#include "nanocc/ir/Instruction.h"
+#include "nanocc/ir/RuntimeLib.h"
+#include "nanocc/ir/Type.h"
+#include "nanocc/ir/Value.h"
+#include "nanocc/transforms/LoopUtils.h"
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace nanocc {
+
+using Opcode = Instruction::Opcode;
+
+static bool isConstValue(Value *V, int32_t val) {
+  auto *C = dynamic_cast<ConstantInt *>(V);
+  return C && C->getValue() == val;
+}
+
+static bool isPure(Instruction *I) {
+  return I->isBinaryOp() || I->getOpcode() == Opcode::GetElemPtr ||
+         I->getOpcode() == Opcode::GetPtr || I->getOpcode() == Opcode::Load;
+}
+
+bool LoopIdiomPass::runOnLoop(Loop *L) {
+  if (L->getBlocks().size() != 2)
+    return false;
+  BasicBlock *header = L->getHeader();
+  BasicBlock *body = L->getBlocks()[1];
+  Instruction *headerTerm = header->getTerminator();
+  Instruction *bodyTerm = body->getTerminator();
+  if (!headerTerm || headerTerm->getOpcode() != Opcode::Br ||
+      headerTerm->getOperand(1) != body || !bodyTerm ||
+      bodyTerm->getOpcode() != Opcode::Jmp)
+    return false;
+  auto *exitBB = static_cast<BasicBlock *>(headerTerm->getOperand(2));
+  if (L->contains(exitBB))
+    return false;
+
+  // header: loads, the exit compare and the branch
+  Instruction *cmp = asOpcode(headerTerm->getOperand(0), Opcode::Lt);
+  if (!cmp || cmp->getParent() != header)
+    return false;
+  std::vector<Instruction *> headerLoads;
+  for (auto &I : header->getInstList()) {
+    if (I.get() == cmp || I.get() == headerTerm)
+      continue;
+    if (I->getOpcode() != Opcode::Load)
+      return false;
+    headerLoads.push_back(I.get());
+  }
+
+  // body: induction slots stepping by one, plus a single other store
+  auto isScalarSlot = [&](Value *V) {
+    auto *slot = asOpcode(V, Opcode::Alloc);
+    return slot && slot->getType()->getPointerElementType()->isIntegerTy() &&
+           AA_.isNonEscapingLocal(slot);
+  };
+  std::unordered_set<Value *> ivSlots;
+  Instruction *store = nullptr;
+  for (auto &I : body->getInstList()) {
+    if (I.get() == bodyTerm || isPure(I.get()))
+      continue;
+    if (I->getOpcode() != Opcode::Store)
+      return false;
+    Value *ptr = I->getOperand(1);
+    if (!isScalarSlot(ptr)) {
+      if (store)
+        return false;
+      store = I.get();
+      continue;
+    }
+    Instruction *inc = asOpcode(I->getOperand(0), Opcode::Add);
+    Instruction *cur =
+        inc ? asOpcode(inc->getOperand(0), Opcode::Load) : nullptr;
+    if (!cur || !isConstValue(inc->getOperand(1), 1) ||
+        cur->getOperand(0) != ptr || !ivSlots.insert(ptr).second)
+      return false;
+  }
+  if (!store)
+    return false;
+
+  // every read of an induction slot must see the value at iteration start
+  std::unordered_set<Value *> stepped;
+  for (auto &I : body->getInstList()) {
+    if (I->getOpcode() == Opcode::Load && stepped.count(I->getOperand(0)))
+      return false;
+    if (I->getOpcode() == Opcode::Store && ivSlots.count(I->getOperand(1)))
+      stepped.insert(I->getOperand(1));
+  }
+  auto isIVLoad = [&](Value *V) {
+    auto *load = asOpcode(V, Opcode::Load);
+    return load && ivSlots.count(load->getOperand(0));
+  };
+
+  // exit test `lt %i, %n` on an induction variable and an invariant bound
+  Instruction *ivLoad = asOpcode(cmp->getOperand(0), Opcode::Load);
+  if (!ivLoad || ivLoad->getParent() != header || !isIVLoad(ivLoad))
+    return false;
+  Value *bound = cmp->getOperand(1);
+  if (!L->isLoopInvariant(bound)) {
+    auto *boundLoad = asOpcode(bound, Opcode::Load);
+    if (!boundLoad || boundLoad->getParent() != header || isIVLoad(boundLoad))
+      return false;
+  }
+
+  // nothing the header reads may be written by the loop
+  Value *dstPtr = store->getOperand(1);
+  for (Instruction *load : headerLoads) {
+    if (!isIVLoad(load) &&
+        AA_.alias(load->getOperand(0), dstPtr) != AliasResult::NoAlias)
+      return false;
+  }
+
+  // values computed in the body die with it, and the header no longer
+  // runs after the last iteration, so its induction loads stay inside
+  auto usedOnlyIn = [](Instruction *I, BasicBlock *A, BasicBlock *B) {
+    for (Use *U = I->use_begin(); U != I->use_end(); U = U->getNext()) {
+      BasicBlock *BB = static_cast<Instruction *>(U->getUser())->getParent();
+      if (BB != A && BB != B)
+        return false;
+    }
+    return true;
+  };
+  for (auto &I : body->getInstList())
+    if (!usedOnlyIn(I.get(), body, body))
+      return false;
+  for (auto &I : header->getInstList())
+    if ((isIVLoad(I.get()) || I.get() == cmp) &&
+        !usedOnlyIn(I.get(), header, body))
+      return false;
+
+  // base + iv, one word per iteration
+  auto isUnitStride = [&](Value *ptr) {
+    PointerDecomposition D = AA_.decompose(ptr);
+    return D.varIndices.size() == 1 && D.varIndices[0].second == 1 &&
+           isIVLoad(D.varIndices[0].first) && L->isLoopInvariant(D.base);
+  };
+
+  // address arithmetic can be recomputed outside the body
+  std::function<bool(Value *)> canClone = [&](Value *V) {
+    auto *I = dynamic_cast<Instruction *>(V);
+    if (!I || I->getParent() != body || isIVLoad(I))
+      return true;
+    if (I->getOpcode() != Opcode::GetElemPtr &&
+        I->getOpcode() != Opcode::GetPtr && !I->isBinaryOp())
+      return false;
+    return canClone(I->getOperand(0)) && canClone(I->getOperand(1));
+  };
+
+  if (!isUnitStride(dstPtr) || !canClone(dstPtr))
+    return false;
+
+  Value *storedVal = store->getOperand(0);
+  Value *srcPtr = nullptr;
+  if (!L->isLoopInvariant(storedVal)) {
+    // a header load keeps its value through the loop unless it reads an
+    // induction slot; the only other store was checked not to alias it
+    auto *load = asOpcode(storedVal, Opcode::Load);
+    bool headerValue =
+        load && load->getParent() == header && !isIVLoad(load);
+    if (!headerValue) {
+      if (!load || load->getParent() != body || !load->hasOneUse() ||
+          !isUnitStride(load->getOperand(0)) || !canClone(load->getOperand(0)))
+        return false;
+      srcPtr = load->getOperand(0);
+    }
+  }
+
+  //===------------------------------------------------------------------===//
+  // Rewrite: header -> loop_idiom -> exit
+  //
+  Function *F = header->getParent();
+  BasicBlock *idiomBB = BasicBlock::create(*F, "loop_idiom");
+  auto &blocks = F->getBasicBlockList();
+  blocks.insert(std::next(std::find(blocks.begin(), blocks.end(), header)),
+                idiomBB);
+
+  IRBuilder builder;
+  builder.setInsertPoint(idiomBB);
+  std::unordered_map<Value *, Value *> ivStart;
+  for (Value *slot : ivSlots)
+    ivStart[slot] = builder.createLoad(slot);
+
+  std::unordered_map<Value *, Value *> cloned;
+  std::function<Value *(Value *)> clone = [&](Value *V) -> Value * {
+    auto *I = dynamic_cast<Instruction *>(V);
+    if (!I || (I->getParent() != body && !isIVLoad(I)))
+      return V;
+    if (isIVLoad(I))
+      return ivStart[I->getOperand(0)];
+    auto it = cloned.find(I);
+    if (it != cloned.end())
+      return it->second;
+    Value *lhs = clone(I->getOperand(0));
+    Value *rhs = clone(I->getOperand(1));
+    Value *result = nullptr;
+    if (I->getOpcode() == Opcode::GetElemPtr)
+      result = builder.createGetElemPtr(lhs, rhs);
+    else if (I->getOpcode() == Opcode::GetPtr)
+      result = builder.createGetPtr(lhs, rhs);
+    else
+      result = builder.createBinaryOp(I->getOpcode(), lhs, rhs);
+    return cloned[I] = result;
+  };
+
+  Value *count = builder.createBinaryOp(Opcode::Sub, bound,
+                                        ivStart[ivLoad->getOperand(0)]);
+  Value *dst = clone(dstPtr);
+  if (srcPtr) {
+    builder.createCall(RuntimeLib::getOrInsertMemcpy(M_),
+                       {dst, clone(srcPtr), count});
+  } else {
+    builder.createCall(RuntimeLib::getOrInsertMemset(M_),
+                       {dst, storedVal, count});
+  }
+  for (Value *slot : ivSlots)
+    builder.createStore(
+        builder.createBinaryOp(Opcode::Add, ivStart[slot], count), slot);
+  builder.createJump(exitBB);
+
+  headerTerm->setOperand(1, idiomBB);
+  for (auto &I : body->getInstList())
+    I->dropAllReferences();
+  body->eraseFromParent();
+  return true;
+}
+
+bool LoopIdiomPass::run(Function &F) {
+  // the routines themselves are the loops we would replace
+  if (F.getName() == RuntimeLib::MemsetName ||
+      F.getName() == RuntimeLib::MemcpyName)
+    return false;
+
+  return runOnLoopsUntilFixpoint(F, [&](Loop *L, LoopInfo &) {
+    // the new calls make their destination arrays escape
+    AA_ = AliasAnalysis();
+    return runOnLoop(L);
+  });
+}
+
+} // namespace nanocc
@@ -0,0 +1,432 @@
+#include "nanocc/transforms/LoopNest.h"
+#include "nanocc/analysis/DependenceAnalysis.h"
+#include "nanocc/analysis/LoopInfo.h"
+#include "nanocc/ir/BasicBlock.h"
+#include "nanocc/ir/Constant.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/IRBuilder.h"
+#include "nanocc/ir/Instruction.h"
+#include "nanocc/ir/Type.h"
+#include "nanocc/transforms/LoopUtils.h"
+#include <algorithm>
+#include <cstdlib>
+#include <optional>
+#include <vector>
+
+namespace nanocc {
+
+using Opcode = Instruction::Opcode;
+
+/// Data cache the nests are tiled for, as modelled by the simulator
+static constexpr int64_t CacheSize = 4096;
+static constexpr int64_t CacheLineSize = 32;
+
+/// Relative cost of an access whose address moves by one word, or by more
+/// than a cache line, per inner iteration
+static constexpr int64_t UnitStrideCost = 1;
+static constexpr int64_t StridedCost = 4;
+
+namespace {
+
+/// The blocks of a perfect nest, see LoopNestPass
+struct LoopNest {
+  CountedLoop outer, inner;
+  BasicBlock *preheader = nullptr;
+  BasicBlock *innerPreheader = nullptr; ///< OB
+  /// `store j0, %J` in OB
+  Instruction *innerInit = nullptr;
+  std::vector<ArrayAccess> accesses;
+};
+
+} // namespace
+
+/// Trip count of a loop from constant init to constant bound in steps of
+/// one, 0 if it does not qualify
+static int64_t getUnitTripCount(const CountedLoop &CL) {
+  return CL.step == 1 ? std::max<int64_t>(getConstantTripCount(CL), 0) : 0;
+}
+
+/// Match the control flow of a perfect nest with outer loop \p L
+static bool matchNest(Loop *L, AliasAnalysis &AA, LoopNest &N) {
+  if (L->getSubLoops().size() != 1)
+    return false;
+  Loop *inner = L->getSubLoops()[0];
+  if (!inner->getSubLoops().empty() ||
+      L->getBlocks().size() != inner->getBlocks().size() + 3 ||
+      !matchCountedLoop(L, AA, N.outer) ||
+      !matchCountedLoop(inner, AA, N.inner) ||
+      getUnitTripCount(N.outer) == 0 || getUnitTripCount(N.inner) == 0)
+    return false;
+  N.preheader = L->getLoopPreheader();
+  N.innerPreheader = inner->getLoopPreheader();
+  if (!N.preheader || N.innerPreheader != N.outer.body ||
+      N.inner.exit != N.outer.latch)
+    return false;
+
+  // the headers hold nothing but the test
+  for (const CountedLoop *CL : {&N.outer, &N.inner}) {
+    if (CL->header->getInstList().size() != 3 ||
+        !usedOnlyBy(CL->cmp, CL->header->getTerminator()))
+      return false;
+    auto *load = asOpcode(CL->cmp->getOperand(0), Opcode::Load);
+    for (Use *U = load->use_begin(); U != load->use_end(); U = U->getNext()) {
+      BasicBlock *userBB = static_cast<Instruction *>(U->getUser())->getParent();
+      if (U->getUser() != CL->cmp &&
+          (!inner->contains(userBB) || userBB == N.inner.header))
+        return false;
+    }
+  }
+  std::vector<BasicBlock *> bodyPreds = N.inner.body->getPredecessors();
+  if (bodyPreds.size() != 1)
+    return false;
+
+  // OB: allocs and the start of the inner loop
+  for (auto &I : N.innerPreheader->getInstList()) {
+    if (I->getOpcode() == Opcode::Alloc || I->isTerminator())
+      continue;
+    if (I->getOpcode() != Opcode::Store || I->getOperand(1) != N.inner.slot ||
+        N.innerInit)
+      return false;
+    N.innerInit = I.get();
+  }
+  // IX: the outer increment
+  Instruction *add = asOpcode(N.outer.stepStore->getOperand(0), Opcode::Add);
+  Instruction *load = asOpcode(add->getOperand(0), Opcode::Load);
+  if (N.outer.latch->getInstList().size() != 4 ||
+      load->getParent() != N.outer.latch || !usedOnlyBy(add, N.outer.stepStore))
+    return false;
+
+  // nothing flows out of the nest but the memory it writes
+  for (BasicBlock *BB : L->getBlocks())
+    for (auto &I : BB->getInstList())
+      for (Use *U = I->use_begin(); U != I->use_end(); U = U->getNext())
+        if (!L->contains(static_cast<Instruction *>(U->getUser())->getParent()))
+          return false;
+  return true;
+}
+
+/// `s = s + x` on a local \p Slot: one load feeding one add whose only
+/// use is the only store to \p Slot in \p L
+static bool isAddReduction(Value *Slot, Loop *L, AliasAnalysis &AA) {
+  if (!AA.isNonEscapingLocal(Slot))
+    return false;
+  Instruction *load = nullptr;
+  Instruction *store = nullptr;
+  for (Use *U = Slot->use_begin(); U != Slot->use_end(); U = U->getNext()) {
+    auto *user = static_cast<Instruction *>(U->getUser());
+    if (!L->contains(user->getParent()))
+      continue;
+    Instruction *&seen = user->getOpcode() == Opcode::Load ? load : store;
+    if (seen)
+      return false;
+    seen = user;
+  }
+  if (!load || !store || load->getParent() != store->getParent())
+    return false;
+  auto *add = asOpcode(store->getOperand(0), Opcode::Add);
+  if (!add || !usedOnlyBy(add, store) || !usedOnlyBy(load, add) ||
+      (add->getOperand(0) != load && add->getOperand(1) != load))
+    return false;
+  // the load comes first
+  for (auto &I : store->getParent()->getInstList()) {
+    if (I.get() == load)
+      return true;
+    if (I.get() == store)
+      return false;
+  }
+  return false;
+}
+
+/// Collect the array accesses of the nest and check that swapping the
+/// loops keeps every dependence
+static bool isInterchangeLegal(LoopNest &N, DependenceAnalysis &DA,
+                               AliasAnalysis &AA) {
+  Loop *L = N.outer.L;
+  Value *ivs[] = {N.outer.slot, N.inner.slot};
+  for (BasicBlock *BB : N.inner.L->getBlocks()) {
+    bool afterStep = false;
+    for (auto &I : BB->getInstList()) {
+      if (I->getOpcode() == Opcode::Call) {
+        if (!AA.getMemoryEffects(I.get()).isPure())
+          return false;
+        continue;
+      }
+      if (I.get() == N.inner.stepStore) {
+        afterStep = true;
+        continue;
+      }
+      if (I->getOpcode() != Opcode::Load && I->getOpcode() != Opcode::Store)
+        continue;
+      Value *ptr = I->getOperand(I->getOpcode() == Opcode::Load ? 0 : 1);
+      if (std::find(std::begin(ivs), std::end(ivs), ptr) != std::end(ivs)) {
+        // would read the other loop's variable after the swap
+        if (afterStep)
+          return false;
+        continue;
+      }
+      auto *slot = asOpcode(ptr, Opcode::Alloc);
+      if (slot && slot->getType()->getPointerElementType()->isIntegerTy()) {
+        if (I->getOpcode() == Opcode::Store && !isAddReduction(slot, L, AA))
+          return false;
+        continue;
+      }
+      N.accesses.push_back(DA.getAccess(I.get()));
+    }
+  }
+
+  std::vector<std::optional<int64_t>> distance;
+  for (size_t a = 0; a < N.accesses.size(); ++a) {
+    for (size_t b = a; b < N.accesses.size(); ++b) {
+      const ArrayAccess &A = N.accesses[a];
+      const ArrayAccess &B = N.accesses[b];
+      if (!A.isWrite && !B.isWrite)
+        continue;
+      if (A.base != B.base) {
+        Value *ptrA = A.inst->getOperand(A.isWrite ? 1 : 0);
+        Value *ptrB = B.inst->getOperand(B.isWrite ? 1 : 0);
+        if (AA.alias(ptrA, ptrB) == AliasResult::NoAlias)
+          continue;
+      }
+      switch (DA.getDistance(A, B, distance)) {
+      case DependenceAnalysis::Result::Independent:
+        continue;
+      case DependenceAnalysis::Result::Unknown:
+        return false;
+      case DependenceAnalysis::Result::Dependent:
+        break;
+      }
+      // a dependence with direction (<, >) would be reversed
+      const std::optional<int64_t> &dI = distance[0];
+      const std::optional<int64_t> &dJ = distance[1];
+      if (!dI && !dJ)
+        return false;
+      if ((!dI && *dJ != 0) || (!dJ && *dI != 0))
+        return false;
+      if (dI && dJ && *dI * *dJ < 0)
+        return false;
+    }
+  }
+  return true;
+}
+
+/// Coefficient of \p IV in the last subscript of \p A, 0 if \p IV does not
+/// appear at all and std::nullopt if it appears in an outer dimension
+static std::optional<int64_t> getStride(const ArrayAccess &A, Value *IV) {
+  for (size_t d = 0; d < A.subscripts.size(); ++d) {
+    auto it = A.subscripts[d].terms.find(IV);
+    if (it == A.subscripts[d].terms.end())
+      continue;
+    if (d + 1 != A.subscripts.size())
+      return std::nullopt;
+    return it->second;
+  }
+  return 0;
+}
+
+/// Cost of the accesses if \p IV is the variable of the inner loop
+static int64_t getAccessCost(const LoopNest &N, Value *IV) {
+  int64_t cost = 0;
+  for (const ArrayAccess &A : N.accesses) {
+    std::optional<int64_t> stride = getStride(A, IV);
+    if (!stride || std::abs(*stride) * 4 >= CacheLineSize)
+      cost += StridedCost;
+    else if (*stride != 0)
+      cost += UnitStrideCost;
+  }
+  return cost;
+}
+
+/// Replace the increment \p StepStore by one of \p Slot
+static void replaceIncrement(Instruction *StepStore, Value *Slot) {
+  IRBuilder builder;
+  builder.setInsertPoint(StepStore);
+  Value *next = builder.createBinaryOp(Opcode::Add, builder.createLoad(Slot),
+                                       ConstantInt::get(Type::getInt32Ty(), 1));
+  builder.createStore(next, Slot);
+  auto *add = static_cast<Instruction *>(StepStore->getOperand(0));
+  StepStore->dropAllReferences();
+  StepStore->eraseFromParent();
+  auto *load = dynamic_cast<Instruction *>(add->getOperand(0));
+  if (add->use_empty()) {
+    eraseIfDead(add);
+    if (load)
+      eraseIfDead(load);
+  }
+}
+
+static void interchange(LoopNest &N) {
+  IRBuilder builder;
+  CountedLoop &O = N.outer;
+  CountedLoop &I = N.inner;
+
+  // header values used in the body are read again at its top
+  for (const CountedLoop *CL : {&O, &I}) {
+    auto *load = static_cast<Instruction *>(CL->cmp->getOperand(0));
+    std::vector<Use *> uses;
+    for (Use *U = load->use_begin(); U != load->use_end(); U = U->getNext())
+      if (U->getUser() != CL->cmp)
+        uses.push_back(U);
+    if (uses.empty())
+      continue;
+    builder.setInsertPoint(I.body->getInstList().front().get());
+    Instruction *copy = builder.createLoad(CL->slot);
+    for (Use *U : uses)
+      U->set(copy);
+  }
+
+  // the outer header tests the inner variable and vice versa
+  auto retest = [&](CountedLoop &CL, Value *Slot, Value *Bound) {
+    auto *old = static_cast<Instruction *>(CL.cmp->getOperand(0));
+    builder.setInsertPoint(CL.cmp);
+    CL.cmp->setOperand(0, builder.createLoad(Slot));
+    CL.cmp->setOperand(1, Bound);
+    eraseIfDead(old);
+  };
+  Value *outerBound = O.bound;
+  retest(O, I.slot, I.bound);
+  retest(I, O.slot, outerBound);
+
+  // the inner slot is now started before the nest
+  hoistToEntry(static_cast<Instruction *>(I.slot));
+  builder.setInsertPoint(N.preheader->getTerminator());
+  builder.createStore(I.init, I.slot);
+  N.innerInit->setOperand(0, O.init);
+  N.innerInit->setOperand(1, O.slot);
+
+  replaceIncrement(I.stepStore, O.slot);
+  replaceIncrement(O.stepStore, I.slot);
+
+  std::swap(O.slot, I.slot);
+  std::swap(O.init, I.init);
+  std::swap(O.bound, I.bound);
+}
+
+/// Strip-mine the inner loop into tiles of \p TileSize iterations and run
+/// the outer loop once per tile
+static void tile(LoopNest &N, int64_t TileSize) {
+  CountedLoop &O = N.outer;
+  CountedLoop &I = N.inner;
+  Function *F = O.header->getParent();
+  Type *i32 = Type::getInt32Ty();
+  auto &blocks = F->getBasicBlockList();
+  IRBuilder builder;
+
+  builder.setInsertPoint(blocks.front()->getInstList().front().get());
+  Instruction *tileSlot = builder.createAlloca(i32);
+
+  BasicBlock *cond = BasicBlock::create(*F, "tile_cond");
+  BasicBlock *body = BasicBlock::create(*F, "tile_body");
+  BasicBlock *latch = BasicBlock::create(*F, "tile_latch");
+  auto headerIt = std::find(blocks.begin(), blocks.end(), O.header);
+  blocks.insert(headerIt, cond);
+  blocks.insert(headerIt, body);
+  blocks.insert(std::next(std::find(blocks.begin(), blocks.end(), O.latch)),
+                latch);
+
+  // preheader: jj = j0
+  Instruction *jump = N.preheader->getTerminator();
+  builder.setInsertPoint(jump);
+  builder.createStore(I.init, tileSlot);
+  jump->setOperand(0, cond);
+
+  // tile_cond: jj < M; tile_body: i = i0
+  builder.setInsertPoint(cond);
+  Value *cmp = builder.createBinaryOp(Opcode::Lt, builder.createLoad(tileSlot),
+                                      I.bound);
+  builder.createCondBr(cmp, body, O.exit);
+  builder.setInsertPoint(body);
+  builder.createStore(O.init, O.slot);
+  builder.createJump(O.header);
+
+  // the outer loop finishes a tile, the inner loop covers [jj, jj + T)
+  Instruction *outerBr = O.header->getTerminator();
+  for (unsigned i = 1; i < outerBr->getNumOperands(); ++i)
+    if (outerBr->getOperand(i) == O.exit)
+      outerBr->setOperand(i, latch);
+  builder.setInsertPoint(N.innerInit);
+  N.innerInit->setOperand(0, builder.createLoad(tileSlot));
+  builder.setInsertPoint(I.cmp);
+  I.cmp->setOperand(1, builder.createBinaryOp(Opcode::Add,
+                                              builder.createLoad(tileSlot),
+                                              ConstantInt::get(i32, TileSize)));
+
+  // tile_latch: jj += T
+  builder.setInsertPoint(latch);
+  Value *next = builder.createBinaryOp(
+      Opcode::Add, builder.createLoad(tileSlot), ConstantInt::get(i32, TileSize));
+  builder.createStore(next, tileSlot);
+  builder.createJump(cond);
+}
+
+/// Tile size for the current loop order, 0 if tiling does not pay off
+static int64_t getTileSize(const LoopNest &N) {
+  // bytes of the accessed lines per inner iteration, counting each
+  // address once
+  int64_t bytesPerIteration = 0;
+  bool reuse = false;
+  std::vector<const ArrayAccess *> seen;
+  for (const ArrayAccess &A : N.accesses) {
+    std::optional<int64_t> stride = getStride(A, N.inner.slot);
+    if (stride && *stride == 0)
+      continue;
+    auto same = [&](const ArrayAccess *B) {
+      if (B->base != A.base || B->subscripts.size() != A.subscripts.size())
+        return false;
+      for (size_t d = 0; d < A.subscripts.size(); ++d)
+        if (B->subscripts[d].terms != A.subscripts[d].terms ||
+            B->subscripts[d].constant != A.subscripts[d].constant)
+          return false;
+      return true;
+    };
+    if (!A.affine || std::any_of(seen.begin(), seen.end(), same))
+      continue;
+    seen.push_back(&A);
+    bool unit = stride && std::abs(*stride) * 4 < CacheLineSize;
+    bytesPerIteration += unit ? std::abs(*stride) * 4 : CacheLineSize;
+    std::optional<int64_t> outerStride = getStride(A, N.outer.slot);
+    reuse |= outerStride && *outerStride == 0;
+  }
+
+  int64_t trips = getUnitTripCount(N.inner);
+  if (!reuse || bytesPerIteration * trips <= CacheSize)
+    return 0;
+  int64_t tileSize = 0;
+  for (int64_t T = 4; T < trips && T * bytesPerIteration <= CacheSize / 2;
+       T *= 2)
+    if (trips % T == 0)
+      tileSize = T;
+  return tileSize;
+}
+
+bool LoopNestPass::runOnLoop(Loop *L) {
+  if (!visited_.insert(L->getHeader()).second)
+    return false;
+  LoopNest N;
+  if (!matchNest(L, AA_, N))
+    return false;
+  DependenceAnalysis DA(L, {N.outer.slot, N.inner.slot}, AA_);
+  if (!isInterchangeLegal(N, DA, AA_))
+    return false;
+
+  bool changed = false;
+  if (getAccessCost(N, N.outer.slot) < getAccessCost(N, N.inner.slot)) {
+    interchange(N);
+    changed = true;
+  }
+  if (int64_t tileSize = getTileSize(N)) {
+    tile(N, tileSize);
+    changed = true;
+  }
+  return changed;
+}
+
+bool LoopNestPass::run(Function &F) {
+  visited_.clear();
+  return runOnLoopsUntilFixpoint(F, [&](Loop *L, LoopInfo &) {
+    // interchange and tiling add counter slots
+    AA_ = AliasAnalysis();
+    return runOnLoop(L);
+  });
+}
+
+} // namespace nanocc
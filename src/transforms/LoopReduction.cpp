@@ -0,0 +1,380 @@
+#include "nanocc/transforms/LoopReduction.h"
+#include "nanocc/analysis/LoopInfo.h"
+#include "nanocc/ir/BasicBlock.h"
+#include "nanocc/ir/Constant.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/IRBuilder.h"
+#include "nanocc/ir/Instruction.h"
+#include "nanocc/ir/Type.h"
+#include "nanocc/transforms/Cloning.h"
+#include "nanocc/transforms/LoopUtils.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace nanocc {
+
+using Opcode = Instruction::Opcode;
+
+/// Partial accumulators per reduction, and copies of the loop body
+static constexpr unsigned NumAccumulators = 4;
+/// Largest loop body that is copied
+static constexpr unsigned MaxBodySize = 40;
+
+namespace {
+
+struct Reduction {
+  Value *slot = nullptr;
+  /// Add, Mul, And, Or or Xor; Gt for max and Lt for min
+  Opcode op = Opcode::Add;
+  /// slots of the accumulators of copies 1..K-1
+  std::vector<Value *> partials;
+};
+
+} // namespace
+
+static int getIdentity(Opcode Op) {
+  switch (Op) {
+  case Opcode::Mul:
+    return 1;
+  case Opcode::And:
+    return -1;
+  case Opcode::Gt:
+    return std::numeric_limits<int32_t>::min();
+  case Opcode::Lt:
+    return std::numeric_limits<int32_t>::max();
+  default:
+    return 0;
+  }
+}
+
+/// `s = s op x` with \p Load and \p Store the only accesses to s
+static bool matchArithmetic(Instruction *Load, Instruction *Store,
+                            Reduction &R) {
+  Instruction *op = dynamic_cast<Instruction *>(Store->getOperand(0));
+  if (!op || Load->getParent() != Store->getParent() ||
+      !usedOnlyBy(Load, op) || !usedOnlyBy(op, Store))
+    return false;
+  switch (op->getOpcode()) {
+  case Opcode::Add:
+  case Opcode::Mul:
+  case Opcode::And:
+  case Opcode::Or:
+  case Opcode::Xor:
+    break;
+  default:
+    return false;
+  }
+  if ((op->getOperand(0) == Load) == (op->getOperand(1) == Load))
+    return false;
+  for (auto &I : Load->getParent()->getInstList()) {
+    if (I.get() == Store)
+      return false;
+    if (I.get() == Load)
+      break;
+  }
+  R.op = op->getOpcode();
+  return true;
+}
+
+/// `if (x > s) s = x` and the like: \p Load feeds the branch of its block
+/// into a block that only does \p Store
+static bool matchMinMax(Instruction *Load, Instruction *Store, Reduction &R) {
+  BasicBlock *test = Load->getParent();
+  BasicBlock *update = Store->getParent();
+  Instruction *br = test->getTerminator();
+  Instruction *cmp = dynamic_cast<Instruction *>(br->getOperand(0));
+  if (br->getOpcode() != Opcode::Br || !cmp || !usedOnlyBy(Load, cmp) ||
+      !usedOnlyBy(cmp, br) || update->getInstList().size() != 2 ||
+      update->getPredecessors().size() != 1)
+    return false;
+  bool storeOnTrue = br->getOperand(1) == update;
+  BasicBlock *join = static_cast<BasicBlock *>(br->getOperand(storeOnTrue ? 2
+                                                                          : 1));
+  if (update->getTerminator()->getOperand(0) != join || join == update)
+    return false;
+
+  // as `x rel s`, with rel true when s becomes x
+  Value *x = cmp->getOperand(cmp->getOperand(0) == Load ? 1 : 0);
+  if (Store->getOperand(0) != x || x == Load)
+    return false;
+  Opcode rel = cmp->getOpcode();
+  auto swapped = [](Opcode Op) {
+    switch (Op) {
+    case Opcode::Lt:
+      return Opcode::Gt;
+    case Opcode::Gt:
+      return Opcode::Lt;
+    case Opcode::Le:
+      return Opcode::Ge;
+    case Opcode::Ge:
+      return Opcode::Le;
+    default:
+      return Op;
+    }
+  };
+  auto inverted = [](Opcode Op) {
+    switch (Op) {
+    case Opcode::Lt:
+      return Opcode::Ge;
+    case Opcode::Gt:
+      return Opcode::Le;
+    case Opcode::Le:
+      return Opcode::Gt;
+    case Opcode::Ge:
+      return Opcode::Lt;
+    default:
+      return Op;
+    }
+  };
+  if (cmp->getOperand(0) == Load)
+    rel = swapped(rel);
+  if (!storeOnTrue)
+    rel = inverted(rel);
+  if (rel == Opcode::Gt || rel == Opcode::Ge)
+    R.op = Opcode::Gt;
+  else if (rel == Opcode::Lt || rel == Opcode::Le)
+    R.op = Opcode::Lt;
+  else
+    return false;
+  return true;
+}
+
+/// Reduction over \p Slot, which the loop stores
+static bool matchReduction(Value *Slot, Loop *L, AliasAnalysis &AA,
+                           Reduction &R) {
+  if (!AA.isNonEscapingLocal(Slot))
+    return false;
+  Instruction *load = nullptr;
+  Instruction *store = nullptr;
+  for (Use *U = Slot->use_begin(); U != Slot->use_end(); U = U->getNext()) {
+    auto *user = static_cast<Instruction *>(U->getUser());
+    if (!L->contains(user->getParent()))
+      continue;
+    Instruction *&seen = user->getOpcode() == Opcode::Load ? load : store;
+    if (seen)
+      return false;
+    seen = user;
+  }
+  if (!load || !store || load->getParent() == L->getHeader())
+    return false;
+  R.slot = Slot;
+  return matchArithmetic(load, store, R) || matchMinMax(load, store, R);
+}
+
+/// Combine the partial results of \p R into its slot at the end of \p BB,
+/// @return the block to continue in
+static BasicBlock *emitCombine(const Reduction &R, BasicBlock *BB) {
+  Function *F = BB->getParent();
+  auto &blocks = F->getBasicBlockList();
+  IRBuilder builder;
+  builder.setInsertPoint(BB);
+  if (R.op != Opcode::Gt && R.op != Opcode::Lt) {
+    Value *result = builder.createLoad(R.slot);
+    for (Value *partial : R.partials)
+      result = builder.createBinaryOp(R.op, result,
+                                      builder.createLoad(partial));
+    builder.createStore(result, R.slot);
+    return BB;
+  }
+  // if (p > s) s = p, per partial result
+  for (Value *partial : R.partials) {
+    auto pos = std::next(std::find(blocks.begin(), blocks.end(), BB));
+    BasicBlock *update = BasicBlock::create(*F, "reduce_update");
+    BasicBlock *next = BasicBlock::create(*F, "reduce");
+    blocks.insert(pos, update);
+    blocks.insert(pos, next);
+    Value *current = builder.createLoad(R.slot);
+    Value *value = builder.createLoad(partial);
+    builder.createCondBr(builder.createBinaryOp(R.op, value, current), update,
+                         next);
+    builder.setInsertPoint(update);
+    builder.createStore(value, R.slot);
+    builder.createJump(next);
+    builder.setInsertPoint(next);
+    BB = next;
+  }
+  return BB;
+}
+
+bool LoopReductionPass::runOnLoop(Loop *L) {
+  if (!visited_.insert(L->getHeader()).second)
+    return false;
+  CountedLoop CL;
+  BasicBlock *oldPreheader = L->getLoopPreheader();
+  if (!L->getSubLoops().empty() || !matchCountedLoop(L, AA_, CL) ||
+      CL.body->getPredecessors().size() != 1 ||
+      (oldPreheader &&
+       oldPreheader->getTerminator()->getOpcode() != Opcode::Jmp))
+    return false;
+  BasicBlock *header = CL.header;
+  for (auto &I : header->getInstList())
+    if (I->getOpcode() == Opcode::Store || I->getOpcode() == Opcode::Call ||
+        I->getOpcode() == Opcode::Alloc)
+      return false;
+
+  unsigned size = 0;
+  std::vector<Value *> stored;
+  for (BasicBlock *BB : L->getBlocks()) {
+    for (auto &I : BB->getInstList()) {
+      size += BB != header;
+      for (Use *U = I->use_begin(); U != I->use_end(); U = U->getNext())
+        if (!L->contains(static_cast<Instruction *>(U->getUser())->getParent()))
+          return false;
+      if (I->getOpcode() == Opcode::Store && I->getOperand(1) != CL.slot)
+        stored.push_back(I->getOperand(1));
+    }
+  }
+  if (size > MaxBodySize)
+    return false;
+
+  // the bound may not change while the loop runs
+  if (auto *bound = dynamic_cast<Instruction *>(CL.bound)) {
+    if (L->contains(bound->getParent())) {
+      if (bound->getOpcode() != Opcode::Load || !L->isLoopInvariant(
+                                                    bound->getOperand(0)))
+        return false;
+      for (BasicBlock *BB : L->getBlocks())
+        for (auto &I : BB->getInstList())
+          if ((I->getOpcode() == Opcode::Store ||
+               I->getOpcode() == Opcode::Call) &&
+              (AA_.getModRefInfo(I.get(), bound->getOperand(0)) & Mod))
+            return false;
+    }
+  }
+  // the main loop runs while `iv < bound - span`
+  const int64_t span = int64_t(NumAccumulators - 1) * CL.step;
+  auto *constBound = dynamic_cast<ConstantInt *>(CL.bound);
+  auto *constInit = dynamic_cast<ConstantInt *>(CL.init);
+  int64_t limit = 0;
+  if (constBound) {
+    limit = constBound->getValue() - span;
+    if (limit < std::numeric_limits<int32_t>::min())
+      return false;
+  } else if (!constInit || constInit->getValue() < 0) {
+    return false;
+  }
+  int64_t trips = getConstantTripCount(CL);
+  if (trips >= 0 && trips < 2 * int64_t(NumAccumulators))
+    return false;
+
+  std::vector<Reduction> reductions;
+  for (Value *slot : stored) {
+    Reduction R;
+    auto *alloc = asOpcode(slot, Opcode::Alloc);
+    if (alloc && alloc->getType()->getPointerElementType()->isIntegerTy() &&
+        matchReduction(slot, L, AA_, R))
+      reductions.push_back(R);
+  }
+  if (reductions.empty())
+    return false;
+
+  Function *F = header->getParent();
+  auto &blocks = F->getBasicBlockList();
+  BasicBlock *preheader = insertPreheader(L);
+  Type *i32 = Type::getInt32Ty();
+  IRBuilder builder;
+
+  // copy k > 0 accumulates into its own local, started at the identity
+  for (Reduction &R : reductions) {
+    for (unsigned k = 1; k < NumAccumulators; ++k) {
+      builder.setInsertPoint(blocks.front()->getInstList().front().get());
+      Instruction *partial = builder.createAlloca(i32);
+      builder.setInsertPoint(preheader->getTerminator());
+      builder.createStore(ConstantInt::get(i32, getIdentity(R.op)), partial);
+      R.partials.push_back(partial);
+    }
+  }
+
+  // main loop test
+  BasicBlock *mainHeader = BasicBlock::create(*F, "reduce_cond");
+  blocks.insert(std::find(blocks.begin(), blocks.end(), header), mainHeader);
+  builder.setInsertPoint(mainHeader);
+  ValueMap headerMap;
+  cloneInstructions(header, builder, headerMap, false);
+  Value *iv = headerMap[CL.cmp->getOperand(0)];
+  Value *test;
+  if (constBound) {
+    test = builder.createBinaryOp(Opcode::Lt, iv,
+                                  ConstantInt::get(i32, int(limit)));
+  } else {
+    // iv >= 0, so `bound - span` only wraps if the loop does not run
+    auto it = headerMap.find(CL.bound);
+    Value *bound = it != headerMap.end() ? it->second : CL.bound;
+    Value *inRange = builder.createBinaryOp(Opcode::Lt, iv, bound);
+    Value *last = builder.createBinaryOp(Opcode::Sub, bound,
+                                         ConstantInt::get(i32, int(span)));
+    test = builder.createBinaryOp(
+        Opcode::And, inRange, builder.createBinaryOp(Opcode::Lt, iv, last));
+  }
+
+  // the copies of the body, each starting with the values of the header
+  std::vector<BasicBlock *> body;
+  for (BasicBlock *BB : L->getBlocks())
+    if (BB != header)
+      body.push_back(BB);
+  std::vector<BasicBlock *> entries, latches;
+  for (unsigned k = 0; k < NumAccumulators; ++k) {
+    ValueMap VMap;
+    std::vector<BasicBlock *> clones;
+    for (BasicBlock *BB : body) {
+      BasicBlock *clone = cloneBasicBlock(BB, *F, "unroll", VMap);
+      blocks.remove(clone);
+      blocks.insert(std::find(blocks.begin(), blocks.end(), header), clone);
+      clones.push_back(clone);
+    }
+    auto *entry = static_cast<BasicBlock *>(VMap[CL.body]);
+    if (k == 0) {
+      for (auto &[original, copy] : headerMap)
+        VMap[original] = copy;
+    } else {
+      builder.setInsertPoint(entry->getInstList().front().get());
+      ValueMap copyMap;
+      cloneInstructions(header, builder, copyMap, false);
+      for (auto &[original, copy] : copyMap)
+        VMap[original] = copy;
+      for (Reduction &R : reductions)
+        VMap[R.slot] = R.partials[k - 1];
+    }
+    for (BasicBlock *clone : clones)
+      for (auto &I : clone->getInstList())
+        remapInstruction(I.get(), VMap);
+    entries.push_back(entry);
+    latches.push_back(static_cast<BasicBlock *>(VMap[CL.latch]));
+  }
+  builder.setInsertPoint(mainHeader);
+  builder.createCondBr(test, entries[0], header);
+  for (unsigned k = 0; k < NumAccumulators; ++k)
+    latches[k]->getTerminator()->setOperand(
+        0, k + 1 < NumAccumulators ? entries[k + 1] : mainHeader);
+  preheader->getTerminator()->setOperand(0, mainHeader);
+
+  // the remaining iterations run in the original loop, then the partial
+  // results are combined
+  BasicBlock *reduce = BasicBlock::create(*F, "reduce");
+  blocks.insert(std::find(blocks.begin(), blocks.end(), CL.exit), reduce);
+  Instruction *headerBr = header->getTerminator();
+  for (unsigned i = 1; i < headerBr->getNumOperands(); ++i)
+    if (headerBr->getOperand(i) == CL.exit)
+      headerBr->setOperand(i, reduce);
+  BasicBlock *last = reduce;
+  for (const Reduction &R : reductions)
+    last = emitCombine(R, last);
+  builder.setInsertPoint(last);
+  builder.createJump(CL.exit);
+
+  visited_.insert(mainHeader);
+  return true;
+}
+
+bool LoopReductionPass::run(Function &F) {
+  visited_.clear();
+  return runOnLoopsUntilFixpoint(F, [&](Loop *L, LoopInfo &) {
+    // every split adds accumulator slots
+    AA_ = AliasAnalysis();
+    return runOnLoop(L);
+  });
+}
+
+} // namespace nanocc
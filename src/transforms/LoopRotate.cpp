@@ -0,0 +1,132 @@
+#include "nanocc/transforms/LoopRotate.h"
+#include "nanocc/analysis/LoopInfo.h"
+#include "nanocc/ir/BasicBlock.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/IRBuilder.h"
+#include "nanocc/ir/Instruction.h"
+#include "nanocc/transforms/Cloning.h"
+#include "nanocc/transforms/LoopUtils.h"
+#include <algorithm>
+#include <vector>
+
+namespace nanocc {
+
+using Opcode = Instruction::Opcode;
+
+/// Bound on the header copied onto the guard and every back edge
+static constexpr size_t MaxHeaderSize = 16;
+
+static bool hasSinglePredecessor(BasicBlock *BB, BasicBlock *Pred) {
+  std::vector<BasicBlock *> preds = BB->getPredecessors();
+  return preds.size() == 1 && preds[0] == Pred;
+}
+
+bool LoopRotatePass::runOnLoop(Loop *L) {
+  BasicBlock *header = L->getHeader();
+  Instruction *term = header->getTerminator();
+  if (!term || term->getOpcode() != Opcode::Br ||
+      header->getInstList().size() > MaxHeaderSize)
+    return false;
+  auto *body = static_cast<BasicBlock *>(term->getOperand(1));
+  auto *exit = static_cast<BasicBlock *>(term->getOperand(2));
+  if (!L->contains(body))
+    std::swap(body, exit);
+  if (body == header || !L->contains(body) || L->contains(exit))
+    return false;
+
+  std::vector<BasicBlock *> latches = L->getLatches();
+  for (BasicBlock *latch : latches)
+    for (BasicBlock *succ : latch->getSuccessors())
+      if (!L->contains(succ))
+        return false; // already bottom-tested
+
+  // header values used elsewhere are recomputed where they are used
+  bool sideEffects = false;
+  bool usedInBody = false;
+  bool usedInExit = false;
+  for (auto &I : header->getInstList()) {
+    if (I->getOpcode() == Opcode::Alloc)
+      return false;
+    sideEffects |=
+        I->getOpcode() == Opcode::Store || I->getOpcode() == Opcode::Call;
+    for (Use *U = I->use_begin(); U != I->use_end(); U = U->getNext()) {
+      BasicBlock *userBB = static_cast<Instruction *>(U->getUser())->getParent();
+      if (userBB == header)
+        continue;
+      if (L->contains(userBB))
+        usedInBody = true;
+      else if (userBB == exit)
+        usedInExit = true;
+      else
+        return false;
+    }
+  }
+  if ((usedInBody || usedInExit) && sideEffects)
+    return false;
+  if (usedInBody && !hasSinglePredecessor(body, header))
+    return false;
+  if (usedInExit && !hasSinglePredecessor(exit, header))
+    return false;
+
+  BasicBlock *preheader = insertPreheader(L);
+  Function *F = header->getParent();
+  IRBuilder builder;
+  auto rematerialize = [&](BasicBlock *BB) {
+    ValueMap VMap;
+    builder.setInsertPoint(BB->getInstList().front().get());
+    cloneInstructions(header, builder, VMap, false);
+    for (auto &I : header->getInstList()) {
+      std::vector<Use *> uses;
+      for (Use *U = I->use_begin(); U != I->use_end(); U = U->getNext())
+        uses.push_back(U);
+      for (Use *U : uses) {
+        BasicBlock *userBB =
+            static_cast<Instruction *>(U->getUser())->getParent();
+        if (userBB != header && (BB == body) == L->contains(userBB))
+          U->set(VMap[I.get()]);
+      }
+    }
+  };
+  if (usedInBody)
+    rematerialize(body);
+  if (usedInExit)
+    rematerialize(exit);
+
+  // the guard, then the test on every back edge
+  auto copyInto = [&](BasicBlock *BB) {
+    ValueMap VMap;
+    Instruction *jump = BB->getTerminator();
+    builder.setInsertPoint(jump);
+    cloneInstructions(header, builder, VMap, true);
+    jump->eraseFromParent();
+  };
+  copyInto(preheader);
+  auto &blocks = F->getBasicBlockList();
+  for (BasicBlock *latch : latches) {
+    Instruction *latchTerm = latch->getTerminator();
+    if (latchTerm->getOpcode() == Opcode::Jmp) {
+      copyInto(latch);
+      continue;
+    }
+    // conditional back edge: the test goes into a block on that edge
+    BasicBlock *edgeBB = BasicBlock::create(*F, "while_latch");
+    blocks.insert(std::next(std::find(blocks.begin(), blocks.end(), latch)),
+                  edgeBB);
+    builder.setInsertPoint(edgeBB);
+    builder.createJump(header);
+    copyInto(edgeBB);
+    for (unsigned i = 0; i < latchTerm->getNumOperands(); ++i)
+      if (latchTerm->getOperand(i) == header)
+        latchTerm->setOperand(i, edgeBB);
+  }
+
+  header->eraseFromParent();
+  return true;
+}
+
+bool LoopRotatePass::run(Function &F) {
+  return runOnLoopsUntilFixpoint(
+      F, [&](Loop *L, LoopInfo &) { return runOnLoop(L); });
+}
+
+} // namespace nanocc
@@ -0,0 +1,163 @@
+#include "nanocc/transforms/LoopUnswitch.h"
+#include "nanocc/analysis/LoopInfo.h"
+#include "nanocc/ir/BasicBlock.h"
+#include "nanocc/ir/Constant.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/GlobalVariable.h"
+#include "nanocc/ir/IRBuilder.h"
+#include "nanocc/ir/Instruction.h"
+#include "nanocc/ir/Type.h"
+#include "nanocc/transforms/Cloning.h"
+#include "nanocc/transforms/LoopUtils.h"
+#include <vector>
+
+namespace nanocc {
+
+using Opcode = Instruction::Opcode;
+
+/// Largest loop that is duplicated
+static constexpr unsigned MaxLoopSize = 120;
+/// Instructions a function may gain from unswitching
+static constexpr unsigned FunctionGrowthBudget = 360;
+
+static Instruction *asInstructionIn(Value *V, Loop *L) {
+  auto *I = dynamic_cast<Instruction *>(V);
+  return (I && L->contains(I->getParent())) ? I : nullptr;
+}
+
+bool LoopUnswitchPass::isInvariantLoad(Instruction *Load, Loop *L) {
+  // only whole objects or constant offsets: the address is known valid
+  Value *ptr = Load->getOperand(0);
+  PointerDecomposition D = AA_.decompose(ptr);
+  auto *base = dynamic_cast<Instruction *>(D.base);
+  bool isObject = dynamic_cast<GlobalVariable *>(D.base) ||
+                  (base && base->getOpcode() == Opcode::Alloc);
+  if (!isObject || !D.varIndices.empty() || !isInvariantCondition(ptr, L))
+    return false;
+
+  for (BasicBlock *BB : L->getBlocks()) {
+    for (auto &I : BB->getInstList()) {
+      if ((I->getOpcode() == Opcode::Store || I->getOpcode() == Opcode::Call) &&
+          (AA_.getModRefInfo(I.get(), ptr) & Mod))
+        return false;
+    }
+  }
+  return true;
+}
+
+bool LoopUnswitchPass::isInvariantCondition(Value *V, Loop *L) {
+  Instruction *I = asInstructionIn(V, L);
+  if (!I)
+    return true;
+  auto cached = invariant_.find(I);
+  if (cached != invariant_.end())
+    return cached->second;
+
+  bool result = false;
+  if (I->getOpcode() == Opcode::Load) {
+    result = isInvariantLoad(I, L);
+  } else if (I->isBinaryOp() || I->getOpcode() == Opcode::GetElemPtr ||
+             I->getOpcode() == Opcode::GetPtr) {
+    result = true;
+    // the copy runs even when the loop would not reach it
+    if (I->getOpcode() == Opcode::Div || I->getOpcode() == Opcode::Mod) {
+      auto *C = dynamic_cast<ConstantInt *>(I->getOperand(1));
+      result = C && C->getValue() != 0;
+    }
+    for (unsigned i = 0; i < I->getNumOperands() && result; ++i)
+      result = isInvariantCondition(I->getOperand(i), L);
+  }
+  invariant_[I] = result;
+  return result;
+}
+
+/// Copy the computation of \p V in front of the insertion point
+static Value *hoistCondition(Value *V, Loop *L, IRBuilder &Builder,
+                             ValueMap &VMap) {
+  Instruction *I = asInstructionIn(V, L);
+  if (!I)
+    return V;
+  auto it = VMap.find(I);
+  if (it != VMap.end())
+    return it->second;
+  auto copy =
+      Instruction::create(I->getType(), I->getOpcode(), I->getNumOperands());
+  for (unsigned i = 0; i < I->getNumOperands(); ++i)
+    copy->setOperand(i, hoistCondition(I->getOperand(i), L, Builder, VMap));
+  Instruction *C = Builder.insert(std::move(copy));
+  VMap[I] = C;
+  return C;
+}
+
+bool LoopUnswitchPass::runOnLoop(Loop *L) {
+  unsigned size = 0;
+  for (BasicBlock *BB : L->getBlocks()) {
+    for (auto &I : BB->getInstList()) {
+      ++size;
+      // there is no phi to merge the two versions after the loop
+      for (Use *U = I->use_begin(); U != I->use_end(); U = U->getNext())
+        if (!L->contains(static_cast<Instruction *>(U->getUser())->getParent()))
+          return false;
+    }
+  }
+  if (size > MaxLoopSize || size > budget_)
+    return false;
+
+  invariant_.clear();
+  Instruction *branch = nullptr;
+  for (BasicBlock *BB : L->getBlocks()) {
+    Instruction *term = BB->getTerminator();
+    if (term && term->getOpcode() == Opcode::Br &&
+        !dynamic_cast<ConstantInt *>(term->getOperand(0)) &&
+        term->getOperand(1) != term->getOperand(2) &&
+        isInvariantCondition(term->getOperand(0), L)) {
+      branch = term;
+      break;
+    }
+  }
+  if (!branch)
+    return false;
+
+  BasicBlock *preheader = insertPreheader(L);
+  BasicBlock *header = L->getHeader();
+  Function *F = header->getParent();
+
+  // the second version of the loop, for a false condition
+  ValueMap VMap;
+  const size_t prefixLen = F->getName().size() + 1;
+  std::vector<BasicBlock *> clones;
+  for (BasicBlock *BB : L->getBlocks()) {
+    std::string name = BB->getName();
+    name = name.size() > prefixLen ? name.substr(prefixLen) : "";
+    clones.push_back(cloneBasicBlock(BB, *F, name, VMap));
+  }
+  for (BasicBlock *BB : clones)
+    for (auto &I : BB->getInstList())
+      remapInstruction(I.get(), VMap);
+
+  IRBuilder builder;
+  Instruction *jump = preheader->getTerminator();
+  builder.setInsertPoint(jump);
+  ValueMap hoisted;
+  Value *cond = hoistCondition(branch->getOperand(0), L, builder, hoisted);
+  builder.createCondBr(cond, header, static_cast<BasicBlock *>(VMap[header]));
+  jump->eraseFromParent();
+
+  Type *i32 = Type::getInt32Ty();
+  static_cast<Instruction *>(VMap[branch])->setOperand(0,
+                                                       ConstantInt::get(i32, 0));
+  branch->setOperand(0, ConstantInt::get(i32, 1));
+  budget_ -= size;
+  return true;
+}
+
+bool LoopUnswitchPass::run(Function &F) {
+  budget_ = FunctionGrowthBudget;
+  return runOnLoopsUntilFixpoint(F, [&](Loop *L, LoopInfo &) {
+    // a versioned loop reads its condition through new blocks
+    AA_ = AliasAnalysis();
+    return runOnLoop(L);
+  });
+}
+
+} // namespace nanocc
@@ -0,0 +1,176 @@
+#include "nanocc/transforms/LoopUtils.h"
+#include "nanocc/analysis/AliasAnalysis.h"
+#include "nanocc/analysis/Dominators.h"
+#include "nanocc/analysis/LoopInfo.h"
+#include "nanocc/ir/BasicBlock.h"
+#include "nanocc/ir/Constant.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/IRBuilder.h"
+#include "nanocc/ir/Instruction.h"
+#include "nanocc/ir/Type.h"
+#include <algorithm>
+#include <vector>
+
+namespace nanocc {
+
+using Opcode = Instruction::Opcode;
+
+bool runOnLoopsUntilFixpoint(
+    Function &F, const std::function<bool(Loop *, LoopInfo &)> &Fn) {
+  bool changed = false;
+  bool localChanged = true;
+  while (localChanged) {
+    localChanged = false;
+    DominatorTree DT(F);
+    LoopInfo LI(F, DT);
+    for (Loop *L : LI.getLoopsInPostorder()) {
+      if (Fn(L, LI)) {
+        localChanged = changed = true;
+        break;
+      }
+    }
+  }
+  return changed;
+}
+
+Instruction *asOpcode(Value *V, Opcode Op) {
+  auto *I = dynamic_cast<Instruction *>(V);
+  return (I && I->getOpcode() == Op) ? I : nullptr;
+}
+
+bool usedOnlyBy(Instruction *I, Instruction *User) {
+  for (Use *U = I->use_begin(); U != I->use_end(); U = U->getNext())
+    if (U->getUser() != User)
+      return false;
+  return true;
+}
+
+void eraseIfDead(Instruction *I) {
+  if (!I->use_empty())
+    return;
+  I->dropAllReferences();
+  I->eraseFromParent();
+}
+
+BasicBlock *insertPreheader(Loop *L) {
+  if (BasicBlock *preheader = L->getLoopPreheader())
+    return preheader;
+
+  BasicBlock *header = L->getHeader();
+  Function *F = header->getParent();
+  BasicBlock *preheader = BasicBlock::create(*F, "preheader");
+  auto &blocks = F->getBasicBlockList();
+  blocks.insert(std::find(blocks.begin(), blocks.end(), header), preheader);
+
+  for (BasicBlock *pred : header->getPredecessors()) {
+    if (L->contains(pred))
+      continue;
+    Instruction *term = pred->getTerminator();
+    for (unsigned i = 0; i < term->getNumOperands(); ++i)
+      if (term->getOperand(i) == header)
+        term->setOperand(i, preheader);
+  }
+  IRBuilder builder;
+  builder.setInsertPoint(preheader);
+  builder.createJump(header);
+  return preheader;
+}
+
+void moveBefore(Instruction *I, Instruction *Pos) {
+  auto &insts = I->getParent()->getInstList();
+  auto it = std::find_if(insts.begin(), insts.end(),
+                         [&](auto &Inst) { return Inst.get() == I; });
+  auto &dest = Pos->getParent()->getInstList();
+  auto pos = std::find_if(dest.begin(), dest.end(),
+                          [&](auto &Inst) { return Inst.get() == Pos; });
+  I->setParent(Pos->getParent());
+  dest.splice(pos, insts, it);
+}
+
+void cloneInstructions(BasicBlock *BB, IRBuilder &Builder, ValueMap &VMap,
+                       bool WithTerminator) {
+  for (auto &I : BB->getInstList()) {
+    if (I.get() == BB->getTerminator() && !WithTerminator)
+      break;
+    auto copy = Instruction::create(I->getType(), I->getOpcode(),
+                                    I->getNumOperands());
+    for (unsigned i = 0; i < I->getNumOperands(); ++i)
+      copy->setOperand(i, I->getOperand(i));
+    Instruction *C = Builder.insert(std::move(copy));
+    remapInstruction(C, VMap);
+    VMap[I.get()] = C;
+  }
+}
+
+void hoistToEntry(Instruction *Alloc) {
+  BasicBlock *entry =
+      Alloc->getParent()->getParent()->getBasicBlockList().front();
+  if (Alloc->getParent() != entry)
+    moveBefore(Alloc, entry->getInstList().front().get());
+}
+
+bool matchCountedLoop(Loop *L, AliasAnalysis &AA, CountedLoop &CL) {
+  CL = CountedLoop();
+  CL.L = L;
+  CL.header = L->getHeader();
+  CL.latch = L->getLoopLatch();
+  Instruction *term = CL.header->getTerminator();
+  if (!CL.latch || CL.latch->getTerminator()->getOpcode() != Opcode::Jmp ||
+      !term || term->getOpcode() != Opcode::Br ||
+      L->getExitingBlocks() != std::vector<BasicBlock *>{CL.header})
+    return false;
+  CL.body = static_cast<BasicBlock *>(term->getOperand(1));
+  CL.exit = static_cast<BasicBlock *>(term->getOperand(2));
+  if (!L->contains(CL.body) || L->contains(CL.exit))
+    return false;
+
+  CL.cmp = asOpcode(term->getOperand(0), Opcode::Lt);
+  if (!CL.cmp || CL.cmp->getParent() != CL.header)
+    return false;
+  Instruction *iv = asOpcode(CL.cmp->getOperand(0), Opcode::Load);
+  if (!iv)
+    return false;
+  CL.slot = iv->getOperand(0);
+  CL.bound = CL.cmp->getOperand(1);
+  auto *slot = asOpcode(CL.slot, Opcode::Alloc);
+  if (!slot || !slot->getType()->getPointerElementType()->isIntegerTy() ||
+      !AA.isNonEscapingLocal(slot))
+    return false;
+
+  for (Use *U = slot->use_begin(); U != slot->use_end(); U = U->getNext()) {
+    auto *user = static_cast<Instruction *>(U->getUser());
+    if (user->getOpcode() != Opcode::Store || !L->contains(user->getParent()))
+      continue;
+    if (CL.stepStore || user->getParent() != CL.latch)
+      return false;
+    CL.stepStore = user;
+  }
+  Instruction *add = CL.stepStore
+                         ? asOpcode(CL.stepStore->getOperand(0), Opcode::Add)
+                         : nullptr;
+  if (!add)
+    return false;
+  Instruction *cur = asOpcode(add->getOperand(0), Opcode::Load);
+  auto *step = dynamic_cast<ConstantInt *>(add->getOperand(1));
+  if (!cur || cur->getOperand(0) != slot || !step || step->getValue() <= 0)
+    return false;
+  CL.step = step->getValue();
+
+  if (BasicBlock *preheader = L->getLoopPreheader()) {
+    for (auto &I : preheader->getInstList())
+      if (I->getOpcode() == Opcode::Store && I->getOperand(1) == slot)
+        CL.init = I->getOperand(0);
+  }
+  return true;
+}
+
+int64_t getConstantTripCount(const CountedLoop &CL) {
+  auto *init = dynamic_cast<ConstantInt *>(CL.init);
+  auto *bound = dynamic_cast<ConstantInt *>(CL.bound);
+  if (!init || !bound)
+    return -1;
+  int64_t span = int64_t(bound->getValue()) - init->getValue();
+  return span <= 0 ? 0 : (span + CL.step - 1) / CL.step;
+}
+
+} // namespace nanocc
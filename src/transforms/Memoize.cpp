@@ -0,0 +1,148 @@
+#include "nanocc/transforms/Memoize.h"
+#include "nanocc/ir/BasicBlock.h"
+#include "nanocc/ir/Constant.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/GlobalVariable.h"
+#include "nanocc/ir/IRBuilder.h"
+#include "nanocc/ir/Instruction.h"
+#include "nanocc/ir/Module.h"
+#include "nanocc/ir/Type.h"
+#include <vector>
+
+namespace nanocc {
+
+using Opcode = Instruction::Opcode;
+
+/// Argument range cached for `f(i32)`
+static constexpr int MemoTableSize = 4096;
+/// Argument ranges cached for `f(i32, i32)`
+static constexpr int MemoRows = 64;
+static constexpr int MemoCols = 64;
+/// Bound on the number of tables, each at most 2 * 4096 words
+static constexpr unsigned MaxMemoizedFunctions = 4;
+
+bool MemoizePass::isCandidate(Function &F) {
+  if (F.isDeclaration() || F.getName() == "main" ||
+      !F.getMemoryEffects().isPure())
+    return false;
+  auto *FT = static_cast<FunctionType *>(F.getType());
+  if (!FT->getFunctionReturnType()->isIntegerTy())
+    return false;
+  const auto &args = F.getArgs();
+  if (args.empty() || args.size() > 2)
+    return false;
+  for (Argument *arg : args)
+    if (!arg->getType()->isIntegerTy())
+      return false;
+
+  // a single self call is a linear chain with nothing to share
+  unsigned selfCalls = 0;
+  for (Use *U = F.use_begin(); U != F.use_end(); U = U->getNext()) {
+    auto *user = dynamic_cast<Instruction *>(U->getUser());
+    if (user && user->getOpcode() == Opcode::Call &&
+        user->getParent()->getParent() == &F)
+      ++selfCalls;
+  }
+  return selfCalls >= 2;
+}
+
+void MemoizePass::memoize(Function &F, Module &M) {
+  Type *i32 = Type::getInt32Ty();
+  auto c = [&](int V) { return ConstantInt::get(i32, V); };
+  const auto &args = F.getArgs();
+  const bool binary = args.size() == 2;
+
+  Type *entryTy = Type::getArrayTy(i32, 2);
+  Type *tableTy =
+      Type::getArrayTy(entryTy, binary ? MemoRows * MemoCols : MemoTableSize);
+  GlobalVariable *table =
+      GlobalVariable::create(tableTy, "__nanocc_memo_" + F.getName(), &M,
+                             ConstantZero::get(tableTy));
+
+  std::vector<Instruction *> rets;
+  for (BasicBlock *BB : F.getBasicBlockList())
+    if (Instruction *term = BB->getTerminator())
+      if (term->getOpcode() == Opcode::Ret)
+        rets.push_back(term);
+
+  // the new entry takes over the allocs of the old one
+  BasicBlock *body = F.getBasicBlockList().front();
+  BasicBlock *entry = BasicBlock::create(F, "memo_entry");
+  F.getBasicBlockList().push_front(entry);
+  auto &bodyInsts = body->getInstList();
+  for (auto it = bodyInsts.begin(); it != bodyInsts.end();) {
+    auto next = std::next(it);
+    if ((*it)->getOpcode() == Opcode::Alloc) {
+      (*it)->setParent(entry);
+      entry->getInstList().splice(entry->getInstList().end(), bodyInsts, it);
+    }
+    it = next;
+  }
+
+  IRBuilder builder;
+  builder.setInsertPoint(entry);
+  auto inBounds = [&](Value *V, int Bound) {
+    Value *lo = builder.createBinaryOp(Opcode::Ge, V, c(0));
+    Value *hi = builder.createBinaryOp(Opcode::Lt, V, c(Bound));
+    return builder.createBinaryOp(Opcode::And, lo, hi);
+  };
+  Value *inRange;
+  Value *idx;
+  if (binary) {
+    inRange = builder.createBinaryOp(Opcode::And, inBounds(args[0], MemoRows),
+                                     inBounds(args[1], MemoCols));
+    idx = builder.createBinaryOp(
+        Opcode::Add, builder.createBinaryOp(Opcode::Mul, args[0], c(MemoCols)),
+        args[1]);
+  } else {
+    inRange = inBounds(args[0], MemoTableSize);
+    idx = args[0];
+  }
+  // only dereferenced on the in-range paths
+  Value *slot = builder.createGetElemPtr(table, idx);
+  Value *validPtr = builder.createGetElemPtr(slot, c(0));
+  Value *valuePtr = builder.createGetElemPtr(slot, c(1));
+
+  BasicBlock *checkBB = BasicBlock::create(F, "memo_check");
+  BasicBlock *hitBB = BasicBlock::create(F, "memo_hit");
+  builder.createCondBr(inRange, checkBB, body);
+
+  F.addBasicBlock(checkBB);
+  builder.setInsertPoint(checkBB);
+  builder.createCondBr(builder.createLoad(validPtr), hitBB, body);
+
+  F.addBasicBlock(hitBB);
+  builder.setInsertPoint(hitBB);
+  builder.createRet(builder.createLoad(valuePtr));
+
+  for (Instruction *ret : rets) {
+    Value *result = ret->getOperand(0);
+    BasicBlock *saveBB = BasicBlock::create(F, "memo_save");
+    BasicBlock *exitBB = BasicBlock::create(F, "memo_exit");
+    builder.setInsertPoint(ret);
+    builder.createCondBr(inRange, saveBB, exitBB);
+    ret->eraseFromParent();
+
+    F.addBasicBlock(saveBB);
+    builder.setInsertPoint(saveBB);
+    builder.createStore(c(1), validPtr);
+    builder.createStore(result, valuePtr);
+    builder.createJump(exitBB);
+
+    F.addBasicBlock(exitBB);
+    builder.setInsertPoint(exitBB);
+    builder.createRet(result);
+  }
+}
+
+bool MemoizePass::run(Module &M) {
+  std::vector<Function *> candidates;
+  for (Function *F : M.getFunctionList())
+    if (candidates.size() < MaxMemoizedFunctions && isCandidate(*F))
+      candidates.push_back(F);
+  for (Function *F : candidates)
+    memoize(*F, M);
+  return !candidates.empty();
+}
+
+} // namespace nanocc
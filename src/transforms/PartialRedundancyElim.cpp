@@ -0,0 +1,386 @@
+#include "nanocc/transforms/PartialRedundancyElim.h"
+#include "nanocc/analysis/Dominators.h"
+#include "nanocc/analysis/LoopInfo.h"
+#include "nanocc/ir/BasicBlock.h"
+#include "nanocc/ir/Constant.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/GlobalVariable.h"
+#include "nanocc/ir/IRBuilder.h"
+#include "nanocc/ir/Type.h"
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <utility>
+
+namespace nanocc {
+
+using Opcode = Instruction::Opcode;
+
+bool PartialRedundancyElimPass::isVariable(Value *Ptr) {
+  auto *I = dynamic_cast<Instruction *>(Ptr);
+  bool isObject = dynamic_cast<GlobalVariable *>(Ptr) ||
+                  (I && I->getOpcode() == Opcode::Alloc &&
+                   AA_.isNonEscapingLocal(I));
+  return isObject && Ptr->getType()->getPointerElementType()->isIntegerTy();
+}
+
+bool PartialRedundancyElimPass::getOperand(Instruction *I, Value *V,
+                                           Operand &Op) {
+  if (auto *C = dynamic_cast<ConstantInt *>(V)) {
+    Op.value = C->getValue();
+    return true;
+  }
+  auto *load = dynamic_cast<Instruction *>(V);
+  if (!load || load->getOpcode() != Opcode::Load ||
+      load->getParent() != I->getParent() || !isVariable(load->getOperand(0)))
+    return false;
+  Op.var = load->getOperand(0);
+  return true;
+}
+
+void PartialRedundancyElimPass::addExpression(Instruction *I) {
+  Operand lhs, rhs;
+  if (!I->isBinaryOp() || !getOperand(I, I->getOperand(0), lhs) ||
+      !getOperand(I, I->getOperand(1), rhs) || (!lhs.var && !rhs.var))
+    return;
+  // a + b and b + a are the same expression
+  if (I->isCommutative() &&
+      (!lhs.var || (rhs.var && std::less<Value *>()(rhs.var, lhs.var))))
+    std::swap(lhs, rhs);
+
+  for (size_t e = 0; e < exprs_.size(); ++e) {
+    const Expression &E = exprs_[e];
+    if (E.opcode == I->getOpcode() && E.lhs == lhs && E.rhs == rhs) {
+      exprOf_[I] = e;
+      return;
+    }
+  }
+  if (exprs_.size() == MaxExpressions)
+    return;
+  exprOf_[I] = exprs_.size();
+  for (Value *var : {lhs.var, rhs.var})
+    if (var)
+      readers_[var].set(exprs_.size());
+  exprs_.push_back({I->getOpcode(), lhs, rhs});
+}
+
+void PartialRedundancyElimPass::collectKills(Instruction *I, ExprSet &Kills) {
+  if (I->getOpcode() != Opcode::Store && I->getOpcode() != Opcode::Call)
+    return;
+  for (auto &[var, readers] : readers_)
+    if (AA_.getModRefInfo(I, var) & Mod)
+      Kills |= readers;
+}
+
+void PartialRedundancyElimPass::computeLocalProperties(BasicBlock *BB) {
+  BlockInfo &info = info_[BB];
+  for (size_t e = 0; e < exprs_.size(); ++e)
+    info.transp.set(e);
+
+  // position of the last kill and the last computation of each expression
+  std::vector<int> lastKill(exprs_.size(), -1);
+  std::vector<Instruction *> previous(exprs_.size(), nullptr);
+  std::unordered_map<Instruction *, int> position;
+  int pos = 0;
+  for (auto &I : BB->getInstList()) {
+    position[I.get()] = pos;
+    ExprSet kills;
+    collectKills(I.get(), kills);
+    for (size_t e = 0; kills.any() && e < exprs_.size(); ++e) {
+      if (!kills.test(e))
+        continue;
+      lastKill[e] = pos;
+      previous[e] = nullptr;
+    }
+    info.comp &= ~kills;
+    info.transp &= ~kills;
+
+    auto it = exprOf_.find(I.get());
+    if (it != exprOf_.end()) {
+      size_t e = it->second;
+      // the value is read by the first load of an operand
+      int first = pos;
+      for (unsigned i = 0; i < 2; ++i)
+        if (auto *load = dynamic_cast<Instruction *>(I->getOperand(i)))
+          first = std::min(first, position[load]);
+      if (lastKill[e] < first) {
+        bool upwardExposed = lastKill[e] < 0;
+        info.occurrences.push_back({I.get(), e, upwardExposed, previous[e]});
+        if (upwardExposed)
+          info.antloc.set(e);
+        info.comp.set(e);
+        previous[e] = I.get();
+      }
+    }
+    ++pos;
+  }
+}
+
+Value *PartialRedundancyElimPass::getTemp(size_t E, Function &F) {
+  Expression &expr = exprs_[E];
+  if (!expr.temp) {
+    IRBuilder builder;
+    builder.setInsertPoint(
+        F.getBasicBlockList().front()->getInstList().front().get());
+    expr.temp = builder.createAlloca(Type::getInt32Ty());
+  }
+  return expr.temp;
+}
+
+Value *PartialRedundancyElimPass::materialize(const Expression &E,
+                                              Instruction *InsertBefore) {
+  IRBuilder builder;
+  builder.setInsertPoint(InsertBefore);
+  auto operand = [&](const Operand &Op) -> Value * {
+    if (Op.var)
+      return builder.createLoad(Op.var);
+    return ConstantInt::get(Type::getInt32Ty(), Op.value);
+  };
+  Value *lhs = operand(E.lhs);
+  Value *rhs = operand(E.rhs);
+  return builder.createBinaryOp(E.opcode, lhs, rhs);
+}
+
+bool PartialRedundancyElimPass::run(Function &F) {
+  AA_ = AliasAnalysis();
+  exprs_.clear();
+  exprOf_.clear();
+  readers_.clear();
+  info_.clear();
+
+  auto &blocks = F.getBasicBlockList();
+  BasicBlock *entry = blocks.front();
+  // the equations assume every block is reachable, SimplifyCFG sees to it
+  for (BasicBlock *BB : blocks)
+    if (BB != entry && BB->getPredecessors().empty())
+      return false;
+
+  for (BasicBlock *BB : blocks)
+    for (auto &I : BB->getInstList())
+      addExpression(I.get());
+  if (exprs_.empty())
+    return false;
+  for (BasicBlock *BB : blocks)
+    computeLocalProperties(BB);
+
+  ExprSet all;
+  for (size_t e = 0; e < exprs_.size(); ++e)
+    all.set(e);
+
+  // available: computed on every path to the point and not killed since
+  for (BasicBlock *BB : blocks)
+    info_[BB].availOut = BB == entry ? info_[BB].comp : all;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (BasicBlock *BB : blocks) {
+      if (BB == entry)
+        continue;
+      ExprSet in = all;
+      for (BasicBlock *pred : BB->getPredecessors())
+        in &= info_[pred].availOut;
+      BlockInfo &info = info_[BB];
+      ExprSet out = info.comp | (in & info.transp);
+      if (out != info.availOut) {
+        info.availOut = out;
+        changed = true;
+      }
+    }
+  }
+
+  // anticipated: computed on every path from the point before a kill
+  for (BasicBlock *BB : blocks)
+    info_[BB].antIn = all;
+  changed = true;
+  while (changed) {
+    changed = false;
+    for (auto it = blocks.rbegin(); it != blocks.rend(); ++it) {
+      BlockInfo &info = info_[*it];
+      std::vector<BasicBlock *> succs = (*it)->getSuccessors();
+      info.antOut = succs.empty() ? ExprSet() : all;
+      for (BasicBlock *succ : succs)
+        info.antOut &= info_[succ].antIn;
+      ExprSet in = info.antloc | (info.antOut & info.transp);
+      if (in != info.antIn) {
+        info.antIn = in;
+        changed = true;
+      }
+    }
+  }
+
+  // earliest: the edge where moving the computation further up would be
+  // unsafe or useless; later: it can still be delayed on every path
+  auto earliest = [&](BasicBlock *From, BasicBlock *To) {
+    const BlockInfo &from = info_[From];
+    return info_[To].antIn & ~from.availOut & (~from.transp | ~from.antOut);
+  };
+  auto later = [&](BasicBlock *From, BasicBlock *To) {
+    const BlockInfo &from = info_[From];
+    return earliest(From, To) | (from.laterIn & ~from.antloc);
+  };
+  for (BasicBlock *BB : blocks)
+    info_[BB].laterIn = BB == entry ? info_[BB].antIn : all;
+  changed = true;
+  while (changed) {
+    changed = false;
+    for (BasicBlock *BB : blocks) {
+      if (BB == entry)
+        continue;
+      ExprSet in = all;
+      for (BasicBlock *pred : BB->getPredecessors())
+        in &= later(pred, BB);
+      if (in != info_[BB].laterIn) {
+        info_[BB].laterIn = in;
+        changed = true;
+      }
+    }
+  }
+
+  std::map<std::pair<BasicBlock *, BasicBlock *>, ExprSet> inserts;
+  std::unordered_map<BasicBlock *, ExprSet> deletes;
+  bool anyDelete = false;
+  for (BasicBlock *BB : blocks) {
+    for (BasicBlock *succ : BB->getSuccessors()) {
+      ExprSet insert = later(BB, succ) & ~info_[succ].laterIn;
+      if (insert.any())
+        inserts[{BB, succ}] = insert;
+    }
+    deletes[BB] = info_[BB].antloc & ~info_[BB].laterIn;
+    anyDelete |= deletes[BB].any();
+  }
+  if (!anyDelete)
+    return false;
+
+  // a computation stores its value for the deleted ones it reaches
+  changed = true;
+  while (changed) {
+    changed = false;
+    for (auto it = blocks.rbegin(); it != blocks.rend(); ++it) {
+      BlockInfo &info = info_[*it];
+      ExprSet out;
+      for (BasicBlock *succ : (*it)->getSuccessors()) {
+        const BlockInfo &s = info_[succ];
+        ExprSet in = deletes[succ] | (s.neededOut & s.transp & ~s.antloc);
+        auto insert = inserts.find({*it, succ});
+        if (insert != inserts.end())
+          in &= ~insert->second;
+        out |= in;
+      }
+      if (out != info.neededOut) {
+        info.neededOut = out;
+        changed = true;
+      }
+    }
+  }
+
+  // the new local lives in memory: storing it on every iteration of a loop
+  // to save computations outside that loop, such as a loop test repeated
+  // after the exit, costs more than it saves
+  DominatorTree DT(F);
+  LoopInfo LI(F, DT);
+  std::vector<std::vector<Loop *>> storeLoops(exprs_.size());
+  for (BasicBlock *BB : blocks) {
+    ExprSet store = info_[BB].comp & info_[BB].neededOut;
+    for (size_t e = 0; e < exprs_.size(); ++e)
+      if (store.test(e) && LI.getLoopFor(BB))
+        storeLoops[e].push_back(LI.getLoopFor(BB));
+  }
+  for (auto &[edge, insert] : inserts) {
+    // innermost loop containing the edge
+    Loop *L = LI.getLoopFor(edge.first);
+    while (L && !L->contains(edge.second))
+      L = L->getParentLoop();
+    for (size_t e = 0; L && e < exprs_.size(); ++e)
+      if (insert.test(e))
+        storeLoops[e].push_back(L);
+  }
+  ExprSet kept;
+  for (size_t e = 0; e < exprs_.size(); ++e)
+    kept.set(e);
+  for (BasicBlock *BB : blocks)
+    for (size_t e = 0; e < exprs_.size(); ++e)
+      for (Loop *L : storeLoops[e])
+        if (deletes[BB].test(e) && !L->contains(BB))
+          kept.reset(e);
+  anyDelete = false;
+  for (BasicBlock *BB : blocks) {
+    deletes[BB] &= kept;
+    info_[BB].neededOut &= kept;
+    anyDelete |= deletes[BB].any();
+  }
+  for (auto &[edge, insert] : inserts)
+    insert &= kept;
+  if (!anyDelete)
+    return false;
+
+  // replace redundant computations; the ones that stay store their value
+  for (BasicBlock *BB : blocks) {
+    BlockInfo &info = info_[BB];
+    std::unordered_map<Instruction *, Value *> replaced;
+    std::vector<Value *> last(exprs_.size(), nullptr);
+    auto valueOf = [&](Instruction *I) -> Value * {
+      auto it = replaced.find(I);
+      return it != replaced.end() ? it->second : I;
+    };
+    for (const Occurrence &occ : info.occurrences) {
+      Value *repl = nullptr;
+      if (occ.previous) {
+        repl = valueOf(occ.previous);
+      } else if (occ.upwardExposed && deletes[BB].test(occ.expr)) {
+        IRBuilder builder;
+        builder.setInsertPoint(occ.inst);
+        repl = builder.createLoad(getTemp(occ.expr, F));
+      }
+      last[occ.expr] = repl ? repl : occ.inst;
+      if (!repl)
+        continue;
+      replaced[occ.inst] = repl;
+      occ.inst->replaceAllUsesWith(repl);
+      occ.inst->dropAllReferences();
+      occ.inst->eraseFromParent();
+    }
+
+    ExprSet store = info.comp & info.neededOut;
+    for (size_t e = 0; store.any() && e < exprs_.size(); ++e) {
+      if (!store.test(e))
+        continue;
+      // a value reloaded from the local is already there
+      auto *load = dynamic_cast<Instruction *>(last[e]);
+      if (load && load->getOpcode() == Opcode::Load &&
+          load->getOperand(0) == exprs_[e].temp)
+        continue;
+      IRBuilder builder;
+      builder.setInsertPoint(BB->getTerminator());
+      builder.createStore(last[e], getTemp(e, F));
+    }
+  }
+
+  // compute the value on the edges where it is missing
+  for (auto &[edge, insert] : inserts) {
+    if (insert.none())
+      continue;
+    auto [from, to] = edge;
+    Instruction *pos = from->getTerminator();
+    if (from->getSuccessors().size() > 1) {
+      BasicBlock *split = BasicBlock::create(F, "pre_edge");
+      blocks.insert(std::next(std::find(blocks.begin(), blocks.end(), from)),
+                    split);
+      for (unsigned i = 0; i < pos->getNumOperands(); ++i)
+        if (pos->getOperand(i) == to)
+          pos->setOperand(i, split);
+      IRBuilder builder;
+      builder.setInsertPoint(split);
+      pos = builder.createJump(to);
+    }
+    for (size_t e = 0; e < exprs_.size(); ++e) {
+      if (!insert.test(e))
+        continue;
+      IRBuilder builder;
+      builder.setInsertPoint(pos);
+      builder.createStore(materialize(exprs_[e], pos), getTemp(e, F));
+    }
+  }
+  return true;
+}
+
+} // namespace nanocc
@@ -0,0 +1,127 @@
+#include "nanocc/transforms/PassPipeline.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/Module.h"
+#include "nanocc/transforms/DeadArgElim.h"
+#include "nanocc/transforms/DeadStoreElim.h"
+#include "nanocc/transforms/FunctionAttrs.h"
+#include "nanocc/transforms/GlobalCodeMotion.h"
+#include "nanocc/transforms/GlobalDCE.h"
+#include "nanocc/transforms/GlobalOpt.h"
+#include "nanocc/transforms/IPSCCP.h"
+#include "nanocc/transforms/IfConversion.h"
+#include "nanocc/transforms/InstCombine.h"
+#include "nanocc/transforms/LoadElim.h"
+#include "nanocc/transforms/LoopDeletion.h"
+#include "nanocc/transforms/LoopFusion.h"
+#include "nanocc/transforms/LoopIdiom.h"
+#include "nanocc/transforms/LoopNest.h"
+#include "nanocc/transforms/LoopReduction.h"
+#include "nanocc/transforms/LoopRotate.h"
+#include "nanocc/transforms/LoopUnswitch.h"
+#include "nanocc/transforms/Memoize.h"
+#include "nanocc/transforms/PartialRedundancyElim.h"
+#include "nanocc/transforms/Reassociate.h"
+#include "nanocc/transforms/SimplifyCFG.h"
+
+namespace nanocc {
+
+/// Per-function cleanup and memory optimizations
+static void runScalarPasses(Function &F) {
+  InstCombinePass().run(F);
+  SimplifyCFGPass().run(F);
+  // before LoadElim, while the operands of an expression are still loaded
+  // next to it
+  PartialRedundancyElimPass().run(F);
+
+  // memory optimizations expose constants and dead address arithmetic
+  LoadElimPass().run(F);
+  DeadStoreElimPass().run(F);
+  // after forwarding, when repeated loads of a variable are one value
+  ReassociatePass().run(F);
+  InstCombinePass().run(F);
+  SimplifyCFGPass().run(F);
+}
+
+void runOptimizationPipeline(Module &M, const PipelineOptions &Opts) {
+  // call summaries let the memory optimizations look across calls
+  FunctionAttrsPass().run(M);
+  for (Function *F : M.getFunctionList())
+    if (!F->isDeclaration())
+      runScalarPasses(*F);
+
+  // constants from read-only globals and across calls fold further inside
+  // each function
+  bool changed = GlobalOptPass().run(M);
+  changed |= IPSCCPPass().run(M);
+  if (changed) {
+    for (Function *F : M.getFunctionList())
+      if (!F->isDeclaration())
+        runScalarPasses(*F);
+  }
+
+  // whole-program cleanup once constants have been substituted
+  DeadArgElimPass().run(M);
+  GlobalDCEPass().run(M);
+  FunctionAttrsPass().run(M);
+  if (Opts.memoize)
+    MemoizePass().run(M);
+
+  // the stores in front of a deleted loop are usually dead as well
+  for (Function *F : M.getFunctionList())
+    if (!F->isDeclaration() && LoopDeletionPass().run(*F))
+      runScalarPasses(*F);
+
+  // the constant branches left in each loop version fold away
+  for (Function *F : M.getFunctionList())
+    if (!F->isDeclaration() && LoopUnswitchPass().run(*F))
+      runScalarPasses(*F);
+
+  // interchange and tiling leave redundant induction variable loads
+  for (Function *F : M.getFunctionList())
+    if (!F->isDeclaration() && LoopNestPass().run(*F))
+      runScalarPasses(*F);
+
+  // loops separated by leftover blocks become adjacent after the cleanup
+  for (Function *F : M.getFunctionList()) {
+    if (F->isDeclaration())
+      continue;
+    while (LoopFusionPass().run(*F))
+      runScalarPasses(*F);
+  }
+
+  // may append the memset/memcpy routines to the module
+  for (Function *F : M.getFunctionList())
+    if (!F->isDeclaration())
+      LoopIdiomPass(M).run(*F);
+
+  // the cleanup merges the unrolled copies and forwards the induction
+  // variable between them
+  for (Function *F : M.getFunctionList())
+    if (!F->isDeclaration() && LoopReductionPass().run(*F))
+      runScalarPasses(*F);
+
+  // after the loop passes, which match min/max as branches; the cleanup
+  // merges each flattened block with its join block, which may expose an
+  // enclosing diamond
+  if (Opts.ifConvert) {
+    for (Function *F : M.getFunctionList()) {
+      if (F->isDeclaration())
+        continue;
+      while (IfConversionPass().run(*F))
+        runScalarPasses(*F);
+    }
+  }
+
+  // the loop passes above match the top-tested shape, rotate last
+  for (Function *F : M.getFunctionList())
+    if (!F->isDeclaration() && LoopRotatePass().run(*F))
+      runScalarPasses(*F);
+
+  // the loop passes match the code in the order the front end emitted it,
+  // so values are only moved to where they are needed at the end
+  for (Function *F : M.getFunctionList())
+    if (!F->isDeclaration())
+      GlobalCodeMotionPass().run(*F);
+}
+
+} // namespace nanocc
@@ -0,0 +1,337 @@
+#include "nanocc/transforms/Reassociate.h"
+#include "nanocc/analysis/Dominators.h"
+#include "nanocc/ir/BasicBlock.h"
+#include "nanocc/ir/Constant.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/IRBuilder.h"
+#include "nanocc/ir/Type.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace nanocc {
+
+using Opcode = Instruction::Opcode;
+
+static ConstantInt *getInt(int32_t v) {
+  return ConstantInt::get(Type::getInt32Ty(), v);
+}
+
+/// The chain \p Op belongs to; subtraction is part of a sum
+static Opcode getChainOpcode(Opcode Op) {
+  return Op == Opcode::Sub ? Opcode::Add : Op;
+}
+
+/// Operation of a chain, other than a plain negation `sub 0, x`
+static bool isChainOp(Value *V) {
+  auto *I = dynamic_cast<Instruction *>(V);
+  if (!I)
+    return false;
+  switch (I->getOpcode()) {
+  case Opcode::Add:
+  case Opcode::Mul:
+  case Opcode::And:
+  case Opcode::Or:
+  case Opcode::Xor:
+    return true;
+  case Opcode::Sub: {
+    auto *C = dynamic_cast<ConstantInt *>(I->getOperand(0));
+    return !C || C->getValue() != 0;
+  }
+  default:
+    return false;
+  }
+}
+
+static uint32_t getIdentity(Opcode Op) {
+  switch (Op) {
+  case Opcode::Mul:
+    return 1;
+  case Opcode::And:
+    return ~0u;
+  default:
+    return 0;
+  }
+}
+
+static uint32_t combine(Opcode Op, uint32_t A, uint32_t B) {
+  switch (Op) {
+  case Opcode::Add:
+    return A + B;
+  case Opcode::Mul:
+    return A * B;
+  case Opcode::And:
+    return A & B;
+  case Opcode::Or:
+    return A | B;
+  default:
+    return A ^ B;
+  }
+}
+
+static Instruction *getSingleUser(Instruction *I) {
+  Use *U = I->use_begin();
+  if (!U || U->getNext())
+    return nullptr;
+  return static_cast<Instruction *>(U->getUser());
+}
+
+unsigned ReassociatePass::getRank(Value *V) {
+  auto it = rank_.find(V);
+  return it != rank_.end() ? it->second : 0;
+}
+
+bool ReassociatePass::canFlatten(Value *V, Opcode Op, Instruction *Root) {
+  auto *I = dynamic_cast<Instruction *>(V);
+  return isChainOp(I) && getChainOpcode(I->getOpcode()) == Op &&
+         I->getParent() == Root->getParent() && getSingleUser(I);
+}
+
+bool ReassociatePass::isRoot(Instruction *I) {
+  if (!isChainOp(I))
+    return false;
+  // otherwise it is flattened into the chain of its user
+  Instruction *user = getSingleUser(I);
+  return !user || !isChainOp(user) ||
+         getChainOpcode(user->getOpcode()) !=
+             getChainOpcode(I->getOpcode()) ||
+         user->getParent() != I->getParent();
+}
+
+void ReassociatePass::flatten(Instruction *I, bool Negated, Instruction *Root,
+                              std::vector<Operand> &Leaves,
+                              std::vector<Instruction *> &Nodes) {
+  Opcode op = getChainOpcode(Root->getOpcode());
+  for (unsigned i = 0; i < 2; ++i) {
+    Value *V = I->getOperand(i);
+    bool negated = Negated != (I->getOpcode() == Opcode::Sub && i == 1);
+    if (canFlatten(V, op, Root)) {
+      Nodes.push_back(static_cast<Instruction *>(V));
+      flatten(static_cast<Instruction *>(V), negated, Root, Leaves, Nodes);
+    } else {
+      Leaves.push_back({V, negated});
+    }
+  }
+}
+
+/// `x * c` or `x << k` with a single use, as x and the factor c or 2^k
+static bool matchTerm(Value *V, Value *&X, uint32_t &Factor, bool &Shift) {
+  auto *I = dynamic_cast<Instruction *>(V);
+  if (!I || !getSingleUser(I) ||
+      (I->getOpcode() != Opcode::Mul && I->getOpcode() != Opcode::Shl))
+    return false;
+  auto *C = dynamic_cast<ConstantInt *>(I->getOperand(1));
+  if (!C)
+    return false;
+  X = I->getOperand(0);
+  Shift = I->getOpcode() == Opcode::Shl;
+  if (!Shift) {
+    Factor = static_cast<uint32_t>(C->getValue());
+    return true;
+  }
+  Factor = 1u << (C->getValue() & 31);
+  return C->getValue() >= 0 && C->getValue() < 32;
+}
+
+bool ReassociatePass::factorSum(std::vector<Operand> &Leaves,
+                                Instruction *InsertBefore) {
+  bool changed = false;
+  std::vector<bool> removed(Leaves.size(), false);
+  for (size_t i = 0; i < Leaves.size(); ++i) {
+    Value *x;
+    uint32_t factor;
+    bool shift;
+    if (removed[i] || !matchTerm(Leaves[i].value, x, factor, shift))
+      continue;
+    std::vector<Operand> terms = {{x}};
+    std::vector<size_t> group = {i};
+    for (size_t j = i + 1; j < Leaves.size(); ++j) {
+      Value *y;
+      uint32_t otherFactor;
+      bool otherShift;
+      if (!removed[j] && Leaves[j].negated == Leaves[i].negated &&
+          matchTerm(Leaves[j].value, y, otherFactor, otherShift) &&
+          otherFactor == factor) {
+        terms.push_back({y});
+        group.push_back(j);
+        shift &= otherShift;
+      }
+    }
+    if (group.size() < 2)
+      continue;
+
+    // x * c + y * c -> (x + y) * c
+    std::stable_sort(terms.begin(), terms.end(),
+                     [&](const Operand &A, const Operand &B) {
+                       return getRank(A.value) < getRank(B.value);
+                     });
+    Value *sum = buildChain(Opcode::Add, terms, InsertBefore);
+    IRBuilder builder;
+    builder.setInsertPoint(InsertBefore);
+    Value *product =
+        shift ? builder.createBinaryOp(
+                    Opcode::Shl, sum,
+                    static_cast<Instruction *>(Leaves[i].value)->getOperand(1))
+              : builder.createBinaryOp(Opcode::Mul, sum,
+                                       getInt(static_cast<int32_t>(factor)));
+    rank_[product] = getRank(sum);
+    for (size_t j : group) {
+      factored_.push_back(static_cast<Instruction *>(Leaves[j].value));
+      removed[j] = true;
+    }
+    Leaves[i].value = product;
+    removed[i] = false;
+    changed = true;
+  }
+
+  std::vector<Operand> remaining;
+  for (size_t i = 0; i < Leaves.size(); ++i)
+    if (!removed[i])
+      remaining.push_back(Leaves[i]);
+  Leaves = std::move(remaining);
+  return changed;
+}
+
+Value *ReassociatePass::buildChain(Opcode Op, std::vector<Operand> &Leaves,
+                                   Instruction *InsertBefore) {
+  IRBuilder builder;
+  builder.setInsertPoint(InsertBefore);
+  Value *acc = nullptr;
+  for (const Operand &leaf : Leaves) {
+    Value *next;
+    if (!acc && leaf.negated)
+      next = builder.createBinaryOp(Opcode::Sub, getInt(0), leaf.value);
+    else if (!acc)
+      next = leaf.value;
+    else if (leaf.negated)
+      next = builder.createBinaryOp(Opcode::Sub, acc, leaf.value);
+    else
+      next = builder.createBinaryOp(Op, acc, leaf.value);
+    if (next != leaf.value)
+      rank_[next] = std::max(acc ? getRank(acc) : 0, getRank(leaf.value));
+    acc = next;
+  }
+  return acc ? acc : getInt(static_cast<int32_t>(getIdentity(Op)));
+}
+
+bool ReassociatePass::isSameLeaves(const std::vector<Operand> &A,
+                                   const std::vector<Operand> &B) {
+  if (A.size() != B.size())
+    return false;
+  for (size_t i = 0; i < A.size(); ++i) {
+    auto *CA = dynamic_cast<ConstantInt *>(A[i].value);
+    auto *CB = dynamic_cast<ConstantInt *>(B[i].value);
+    bool same = CA && CB ? CA->getValue() == CB->getValue()
+                         : A[i].value == B[i].value;
+    if (!same || A[i].negated != B[i].negated)
+      return false;
+  }
+  return true;
+}
+
+bool ReassociatePass::rewrite(Instruction *Root) {
+  Opcode op = getChainOpcode(Root->getOpcode());
+  std::vector<Operand> original;
+  std::vector<Instruction *> nodes = {Root};
+  flatten(Root, false, Root, original, nodes);
+
+  // fold the constants into one
+  uint32_t constant = getIdentity(op);
+  std::vector<Operand> leaves;
+  for (const Operand &leaf : original) {
+    if (auto *C = dynamic_cast<ConstantInt *>(leaf.value)) {
+      auto value = static_cast<uint32_t>(C->getValue());
+      constant = combine(op, constant, leaf.negated ? 0u - value : value);
+    } else {
+      leaves.push_back(leaf);
+    }
+  }
+
+  // x - x, x ^ x, x & x, x | x
+  for (size_t i = 0; i < leaves.size(); ++i) {
+    for (size_t j = i + 1; j < leaves.size(); ++j) {
+      if (leaves[j].value != leaves[i].value)
+        continue;
+      bool cancel = op == Opcode::Xor ||
+                    (op == Opcode::Add &&
+                     leaves[i].negated != leaves[j].negated);
+      if (!cancel && op != Opcode::And && op != Opcode::Or)
+        continue;
+      leaves.erase(leaves.begin() + j);
+      if (cancel) {
+        leaves.erase(leaves.begin() + i);
+        --i;
+      }
+      break;
+    }
+  }
+
+  if ((op == Opcode::Mul || op == Opcode::And) && constant == 0)
+    leaves.clear();
+  if (op == Opcode::Or && constant == ~0u)
+    leaves.clear();
+
+  factored_.clear();
+  bool factored = op == Opcode::Add && factorSum(leaves, Root);
+  std::stable_sort(leaves.begin(), leaves.end(),
+                   [&](const Operand &A, const Operand &B) {
+                     return getRank(A.value) < getRank(B.value);
+                   });
+  auto positive = std::find_if(leaves.begin(), leaves.end(),
+                               [](const Operand &A) { return !A.negated; });
+  if (positive != leaves.end())
+    std::rotate(leaves.begin(), positive, positive + 1);
+  if (constant != getIdentity(op) || leaves.empty()) {
+    // c - x rather than (0 - x) + c
+    Operand C = {getInt(static_cast<int32_t>(constant))};
+    if (positive == leaves.end())
+      leaves.insert(leaves.begin(), C);
+    else
+      leaves.push_back(C);
+  }
+  if (!factored && isSameLeaves(leaves, original))
+    return false;
+
+  Value *result = buildChain(op, leaves, Root);
+  Root->replaceAllUsesWith(result);
+  // operands before their users
+  for (Instruction *I : nodes)
+    I->dropAllReferences();
+  for (Instruction *I : nodes)
+    I->eraseFromParent();
+  for (Instruction *I : factored_) {
+    I->dropAllReferences();
+    I->eraseFromParent();
+  }
+  return true;
+}
+
+bool ReassociatePass::run(Function &F) {
+  rank_.clear();
+  unsigned rank = 0;
+  for (Argument *arg : F.getArgs())
+    rank_[arg] = ++rank;
+
+  // a chain operation ranks with its highest operand
+  DominatorTree DT(F);
+  std::vector<Instruction *> roots;
+  for (BasicBlock *BB : DT.getReversePostOrder()) {
+    for (auto &I : BB->getInstList()) {
+      if (!isChainOp(I.get())) {
+        rank_[I.get()] = ++rank;
+        continue;
+      }
+      rank_[I.get()] = std::max(getRank(I->getOperand(0)),
+                                getRank(I->getOperand(1)));
+      if (isRoot(I.get()))
+        roots.push_back(I.get());
+    }
+  }
+
+  // each root comes after the roots of its operands
+  bool changed = false;
+  for (Instruction *Root : roots)
+    changed |= rewrite(Root);
+  return changed;
+}
+
+} // namespace nanocc
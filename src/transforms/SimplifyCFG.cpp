@@ -0,0 +1,271 @@
+#include "nanocc/transforms/SimplifyCFG.h"
+#include "nanocc/ir/BasicBlock.h"
+#include "nanocc/ir/Constant.h"
+#include "nanocc/ir/Function.h"
+#include "nanocc/ir/IRBuilder.h"
+#include "nanocc/ir/Instruction.h"
+#include "nanocc/ir/Type.h"
+#include "nanocc/ir/Value.h"
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace nanocc {
+
+using Opcode = Instruction::Opcode;
+
+static Instruction *asOpcode(Value *V, Opcode op) {
+  auto *I = dynamic_cast<Instruction *>(V);
+  return (I && I->getOpcode() == op) ? I : nullptr;
+}
+
+/// Replace the terminator of \p BB with `jump Target`
+static void replaceWithJump(BasicBlock *BB, BasicBlock *Target) {
+  Instruction *term = BB->getTerminator();
+  IRBuilder builder;
+  builder.setInsertPoint(term);
+  builder.createJump(Target);
+  term->eraseFromParent();
+}
+
+/// Retarget every edge from \p Pred to \p From so that it goes to \p To
+static void redirectEdge(BasicBlock *Pred, BasicBlock *From, BasicBlock *To) {
+  Instruction *term = Pred->getTerminator();
+  for (unsigned i = 0; i < term->getNumOperands(); ++i)
+    if (term->getOperand(i) == From)
+      term->setOperand(i, To);
+}
+
+/// A scalar `alloc` that is only ever loaded from and stored to directly,
+/// so no call or pointer store can change it behind our back.
+static bool isLocalScalarSlot(Value *V) {
+  auto *slot = asOpcode(V, Opcode::Alloc);
+  if (!slot || !slot->getType()->getPointerElementType()->isIntegerTy())
+    return false;
+  for (Use *U = slot->use_begin(); U != slot->use_end(); U = U->getNext()) {
+    auto *user = static_cast<Instruction *>(U->getUser());
+    if (user->getOpcode() == Opcode::Load)
+      continue;
+    if (user->getOpcode() == Opcode::Store && user->getOperand(1) == slot &&
+        user->getOperand(0) != slot)
+      continue;
+    return false;
+  }
+  return true;
+}
+
+/// Value held by \p Slot when control leaves \p BB, if \p BB stores it
+static Value *getStoredValueAtEnd(BasicBlock *BB, Value *Slot) {
+  auto &instList = BB->getInstList();
+  for (auto it = instList.rbegin(); it != instList.rend(); ++it) {
+    Instruction *I = it->get();
+    if (I->getOpcode() == Opcode::Store && I->getOperand(1) == Slot)
+      return I->getOperand(0);
+  }
+  return nullptr;
+}
+
+bool SimplifyCFGPass::removeUnreachableBlocks(Function &F) {
+  auto &blocks = F.getBasicBlockList();
+  std::unordered_set<BasicBlock *> reachable;
+  std::vector<BasicBlock *> stack{blocks.front()};
+  reachable.insert(blocks.front());
+  while (!stack.empty()) {
+    BasicBlock *BB = stack.back();
+    stack.pop_back();
+    for (BasicBlock *succ : BB->getSuccessors())
+      if (reachable.insert(succ).second)
+        stack.push_back(succ);
+  }
+
+  std::vector<BasicBlock *> dead;
+  for (BasicBlock *BB : blocks)
+    if (!reachable.count(BB))
+      dead.push_back(BB);
+  if (dead.empty())
+    return false;
+
+  // dead blocks may branch to each other, unlink everything first
+  for (BasicBlock *BB : dead)
+    for (auto &I : BB->getInstList())
+      I->dropAllReferences();
+  for (BasicBlock *BB : dead)
+    BB->eraseFromParent();
+  return true;
+}
+
+/// `br 1, T, F` -> `jump T`, `br c, T, T` -> `jump T`
+bool SimplifyCFGPass::foldBranch(BasicBlock *BB) {
+  Instruction *term = BB->getTerminator();
+  if (!term || term->getOpcode() != Opcode::Br)
+    return false;
+
+  auto *trueBB = static_cast<BasicBlock *>(term->getOperand(1));
+  auto *falseBB = static_cast<BasicBlock *>(term->getOperand(2));
+  if (auto *C = dynamic_cast<ConstantInt *>(term->getOperand(0))) {
+    replaceWithJump(BB, C->getValue() ? trueBB : falseBB);
+    return true;
+  }
+  if (trueBB == falseBB) {
+    replaceWithJump(BB, trueBB);
+    return true;
+  }
+  return false;
+}
+
+/// A block holding only `jump S` is bypassed by sending its
+/// predecessors straight to S.
+bool SimplifyCFGPass::removeForwardingBlock(BasicBlock *BB) {
+  if (BB == BB->getParent()->getBasicBlockList().front())
+    return false;
+  if (BB->getInstList().size() != 1)
+    return false;
+  Instruction *term = BB->getTerminator();
+  if (!term || term->getOpcode() != Opcode::Jmp)
+    return false;
+  auto *succ = static_cast<BasicBlock *>(term->getOperand(0));
+  if (succ == BB)
+    return false;
+
+  BB->replaceAllUsesWith(succ);
+  BB->eraseFromParent();
+  return true;
+}
+
+/// P: ...; jump BB   +   BB: ... (only reached from P)   ->   P: ...; ...
+bool SimplifyCFGPass::mergeIntoPredecessor(BasicBlock *BB) {
+  if (BB == BB->getParent()->getBasicBlockList().front())
+    return false;
+  std::vector<BasicBlock *> preds = BB->getPredecessors();
+  if (preds.size() != 1 || preds[0] == BB)
+    return false;
+  BasicBlock *pred = preds[0];
+  Instruction *predTerm = pred->getTerminator();
+  if (!predTerm || predTerm->getOpcode() != Opcode::Jmp)
+    return false;
+
+  predTerm->eraseFromParent();
+  for (auto &I : BB->getInstList())
+    I->setParent(pred);
+  pred->getInstList().splice(pred->getInstList().end(), BB->getInstList());
+  BB->eraseFromParent();
+  return true;
+}
+
+/// Send predecessors of \p BB directly to the successor its branch would
+/// take. Only blocks without other side effects are threaded:
+///
+///   BB: br %c, T, F          reached from `br %c, BB, X` -> T
+///   BB: %v = load %flag      reached from `store 0, %flag; ...` -> F
+///       br %v, T, F          reached from `store %x, %flag; jump BB`
+///                              -> `br %x, T, F`
+bool SimplifyCFGPass::threadEdges(BasicBlock *BB) {
+  Instruction *term = BB->getTerminator();
+  if (!term || term->getOpcode() != Opcode::Br)
+    return false;
+  Value *cond = term->getOperand(0);
+  auto *trueBB = static_cast<BasicBlock *>(term->getOperand(1));
+  auto *falseBB = static_cast<BasicBlock *>(term->getOperand(2));
+  if (trueBB == BB || falseBB == BB)
+    return false;
+
+  auto &instList = BB->getInstList();
+  bool changed = false;
+
+  if (instList.size() == 1) {
+    for (BasicBlock *pred : BB->getPredecessors()) {
+      Instruction *predTerm = pred->getTerminator();
+      if (pred == BB || predTerm->getOpcode() != Opcode::Br ||
+          predTerm->getOperand(0) != cond)
+        continue;
+      if (predTerm->getOperand(1) == BB)
+        predTerm->setOperand(1, trueBB);
+      if (predTerm->getOperand(2) == BB)
+        predTerm->setOperand(2, falseBB);
+      changed = true;
+    }
+    return changed;
+  }
+
+  Instruction *load = asOpcode(cond, Opcode::Load);
+  if (instList.size() != 2 || !load || load->getParent() != BB ||
+      !load->hasOneUse() || !isLocalScalarSlot(load->getOperand(0)))
+    return false;
+
+  Value *slot = load->getOperand(0);
+  for (BasicBlock *pred : BB->getPredecessors()) {
+    if (pred == BB)
+      continue;
+    Value *stored = getStoredValueAtEnd(pred, slot);
+    if (!stored)
+      continue;
+    if (auto *C = dynamic_cast<ConstantInt *>(stored)) {
+      redirectEdge(pred, BB, C->getValue() ? trueBB : falseBB);
+      changed = true;
+      continue;
+    }
+    Instruction *predTerm = pred->getTerminator();
+    if (predTerm->getOpcode() == Opcode::Jmp) {
+      IRBuilder builder;
+      builder.setInsertPoint(predTerm);
+      builder.createCondBr(stored, trueBB, falseBB);
+      predTerm->eraseFromParent();
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+/// Reverse postorder keeps every definition ahead of its dominated uses.
+/// Successors are pushed false-edge first so the true edge follows the
+/// branch directly.
+void SimplifyCFGPass::layoutBlocks(Function &F) {
+  auto &blocks = F.getBasicBlockList();
+  std::unordered_set<BasicBlock *> visited;
+  std::vector<BasicBlock *> postorder;
+  std::vector<std::pair<BasicBlock *, std::vector<BasicBlock *>>> stack;
+
+  auto enter = [&](BasicBlock *BB) {
+    visited.insert(BB);
+    stack.emplace_back(BB, BB->getSuccessors());
+  };
+
+  enter(blocks.front());
+  while (!stack.empty()) {
+    auto &pending = stack.back().second;
+    if (pending.empty()) {
+      postorder.push_back(stack.back().first);
+      stack.pop_back();
+      continue;
+    }
+    BasicBlock *succ = pending.back();
+    pending.pop_back();
+    if (!visited.count(succ))
+      enter(succ);
+  }
+
+  blocks.assign(postorder.rbegin(), postorder.rend());
+}
+
+bool SimplifyCFGPass::run(Function &F) {
+  bool changed = false;
+  bool localChanged = true;
+  while (localChanged) {
+    localChanged = removeUnreachableBlocks(F);
+
+    // each helper may erase only the block it is given
+    std::vector<BasicBlock *> blocks(F.getBasicBlockList().begin(),
+                                     F.getBasicBlockList().end());
+    for (BasicBlock *BB : blocks) {
+      if (foldBranch(BB) || removeForwardingBlock(BB) ||
+          mergeIntoPredecessor(BB) || threadEdges(BB))
+        localChanged = true;
+    }
+    changed |= localChanged;
+  }
+
+  layoutBlocks(F);
+  return changed;
+}
+
+} // namespace nanocc
@@ -0,0 +1,88 @@
+# Compile SOURCE with COMPILER and check the result:
+#
+#   - the Koopa IR must match every regular expression in REQUIRE and none
+#     in FORBID, which tells whether a transform fired; `[^:]*` stays
+#     within a basic block, as only labels contain a colon;
+#   - if NODE is set, the RISC-V output runs in the playground simulator
+#     and must print what the `// Expected output:` lines of SOURCE say,
+#     up to whitespace; with MAX_CACHE_MISSES, it may miss the simulated
+#     data cache at most that many times, which tells whether a locality
+#     transform fired.
+#
+# FLAGS are extra compiler options. REQUIRE, FORBID and FLAGS are lists
+# separated by `|`, which the expressions therefore cannot use.
+#
+#   cmake -DCOMPILER=... -DSOURCE=... -DOUTPUT=<prefix> [-DREQUIRE=...]
+#         [-DFORBID=...] [-DFLAGS=...] [-DNODE=... -DSIMULATOR=...
+#         -DRUNNER=... [-DMAX_CACHE_MISSES=...]] -P CheckProgram.cmake
+
+foreach(var REQUIRE FORBID FLAGS)
+  string(REPLACE "|" ";" ${var} "${${var}}")
+endforeach()
+
+execute_process(
+  COMMAND ${COMPILER} -koopa ${SOURCE} -o ${OUTPUT}.koopa ${FLAGS}
+  RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "${SOURCE}: compiler exited with ${result}")
+endif()
+
+file(READ ${OUTPUT}.koopa koopa)
+foreach(regex IN LISTS REQUIRE)
+  if(NOT koopa MATCHES "${regex}")
+    message(FATAL_ERROR "${SOURCE}: Koopa IR does not match `${regex}`")
+  endif()
+endforeach()
+foreach(regex IN LISTS FORBID)
+  if(koopa MATCHES "${regex}")
+    message(FATAL_ERROR "${SOURCE}: Koopa IR matches `${regex}`")
+  endif()
+endforeach()
+
+if(NOT NODE)
+  return()
+endif()
+
+file(STRINGS ${SOURCE} lines REGEX "// Expected output:")
+if(NOT lines)
+  message(FATAL_ERROR "${SOURCE}: no `// Expected output:` line")
+endif()
+set(expected "")
+foreach(line IN LISTS lines)
+  string(REGEX REPLACE ".*// Expected output:" "" line "${line}")
+  string(STRIP "${line}" line)
+  string(APPEND expected " ${line}")
+endforeach()
+string(STRIP "${expected}" expected)
+
+execute_process(
+  COMMAND ${COMPILER} -riscv ${SOURCE} -o ${OUTPUT}.s ${FLAGS}
+  RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "${SOURCE}: compiler exited with ${result}")
+endif()
+
+execute_process(
+  COMMAND ${NODE} ${RUNNER} ${SIMULATOR} ${OUTPUT}.s
+  OUTPUT_VARIABLE actual
+  ERROR_VARIABLE stats
+  RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "${SOURCE}: simulator exited with ${result}\n${stats}")
+endif()
+string(REGEX REPLACE "[ \t\r\n]+" " " actual "${actual}")
+string(STRIP "${actual}" actual)
+if(NOT actual STREQUAL expected)
+  message(FATAL_ERROR
+    "${SOURCE}: printed `${actual}`, expected `${expected}`")
+endif()
+
+if(DEFINED MAX_CACHE_MISSES AND NOT MAX_CACHE_MISSES STREQUAL "")
+  if(NOT stats MATCHES "cache: ([0-9]+)/")
+    message(FATAL_ERROR "${SOURCE}: no cache statistics")
+  endif()
+  if(CMAKE_MATCH_1 GREATER MAX_CACHE_MISSES)
+    message(FATAL_ERROR "${SOURCE}: ${CMAKE_MATCH_1} cache misses, "
+      "expected at most ${MAX_CACHE_MISSES}")
+  endif()
+endif()
@@ -0,0 +1,131 @@
+// Check of the division and modulo sequences the RISC-V backend emits for a
+// constant divisor: the instructions of ExpandDivRemByConst, which
+// FunctionCodeGen::EmitDivRemByConst prints, are interpreted on boundary
+// and random dividends and compared with C semantics (truncating division,
+// remainder with the sign of the dividend).
+
+#include "nanocc/backend/DivMagic.h"
+
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+/// Run \p insts with \p n in t0 and return t0; arithmetic wraps around
+int32_t run(const std::vector<DivRemInst> &insts, int32_t n) {
+  uint32_t regs[4] = {0, static_cast<uint32_t>(n), 0, 0};
+  for (const DivRemInst &inst : insts) {
+    uint32_t a = regs[inst.rs1], b = regs[inst.rs2];
+    uint32_t result = 0;
+    switch (inst.op) {
+    case DivRemInst::Li:
+      result = static_cast<uint32_t>(inst.imm);
+      break;
+    case DivRemInst::Mv:
+      result = a;
+      break;
+    case DivRemInst::Add:
+      result = a + b;
+      break;
+    case DivRemInst::Sub:
+      result = a - b;
+      break;
+    case DivRemInst::And:
+      result = a & b;
+      break;
+    case DivRemInst::Mul:
+      result = a * b;
+      break;
+    case DivRemInst::Mulh:
+      result = static_cast<uint32_t>(
+          (static_cast<int64_t>(static_cast<int32_t>(a)) *
+           static_cast<int32_t>(b)) >>
+          32);
+      break;
+    case DivRemInst::Srai:
+      result = static_cast<uint32_t>(static_cast<int32_t>(a) >> inst.imm);
+      break;
+    case DivRemInst::Srli:
+      result = a >> inst.imm;
+      break;
+    }
+    if (inst.rd != DivRemInst::Zero)
+      regs[inst.rd] = result;
+  }
+  return static_cast<int32_t>(regs[DivRemInst::T0]);
+}
+
+/// Dividends where rounding goes wrong first: the ends of the range, zero,
+/// and multiples of \p d near them and their neighbours
+std::vector<int32_t> boundaryDividends(int32_t d) {
+  std::vector<int64_t> bases = {INT_MIN, INT_MAX, 0};
+  int64_t quotient = INT_MAX / (d < 0 ? -static_cast<int64_t>(d) : d);
+  for (int64_t q : {int64_t(1), int64_t(2), quotient - 1, quotient}) {
+    bases.push_back(q * d);
+    bases.push_back(-q * d);
+  }
+  std::vector<int32_t> values;
+  for (int64_t base : bases)
+    for (int64_t delta = -2; delta <= 2; ++delta)
+      if (base + delta >= INT_MIN && base + delta <= INT_MAX)
+        values.push_back(static_cast<int32_t>(base + delta));
+  return values;
+}
+
+/// @return the number of wrong results for \p d
+int check(int32_t d, unsigned samples, std::mt19937 &rng) {
+  std::vector<int32_t> dividends = boundaryDividends(d);
+  std::uniform_int_distribution<int32_t> any(INT_MIN, INT_MAX);
+  for (unsigned i = 0; i < samples; ++i)
+    dividends.push_back(any(rng));
+
+  std::vector<DivRemInst> div = ExpandDivRemByConst(false, d);
+  std::vector<DivRemInst> rem = ExpandDivRemByConst(true, d);
+  int failures = 0;
+  for (int32_t n : dividends) {
+    // in 64 bits, INT_MIN / -1 wraps around as on RISC-V
+    auto q = static_cast<int32_t>(static_cast<int64_t>(n) / d);
+    auto r = static_cast<int32_t>(static_cast<int64_t>(n) % d);
+    int32_t gotQ = run(div, n), gotR = run(rem, n);
+    if (gotQ != q || gotR != r) {
+      if (++failures <= 5)
+        std::printf("%d / %d: got %d, %d; expected %d, %d\n", n, d, gotQ,
+                    gotR, q, r);
+    }
+  }
+  return failures;
+}
+
+} // namespace
+
+int main() {
+  std::mt19937 rng(2024);
+  int failures = 0;
+
+  // small, negative, large and power-of-two divisors
+  const int32_t divisors[] = {
+      1,       -1,          2,       -2,         3,       -3,
+      5,       -5,          7,       -7,         10,      -10,
+      641,     -641,        4,       -4,         8,       -16,
+      1024,    -4096,       1 << 30, -(1 << 30), INT_MIN, INT_MAX,
+      INT_MIN + 1,
+  };
+  for (int32_t d : divisors)
+    failures += check(d, 100000, rng);
+
+  // and random ones of every magnitude
+  std::uniform_int_distribution<int> bits(1, 31);
+  for (int i = 0; i < 2000; ++i) {
+    std::uniform_int_distribution<int32_t> magnitude(1, INT32_MAX >>
+                                                            (31 - bits(rng)));
+    int32_t d = magnitude(rng);
+    failures += check(i % 2 ? d : -d, 1000, rng);
+  }
+
+  if (failures)
+    std::printf("%d wrong results\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,23 @@
+// Run a RISC-V assembly file in the playground simulator and print what the
+// program writes with putint/putch/putarray. The data cache statistics go
+// to stderr as `cache: <misses>/<accesses>`.
+//
+//   node RunRiscv.js <miniriscv.js> <file.s>
+
+const fs = require('fs');
+const path = require('path');
+
+const MiniRiscV = require(path.resolve(process.argv[2]));
+
+// getint reads 0; tests call it to hide values from the optimizer
+global.prompt = () => '';
+
+const sim = new MiniRiscV();
+sim.parse(fs.readFileSync(process.argv[3], 'utf8'));
+let output = '';
+sim.run((text) => {
+  output += text;
+});
+process.stdout.write(output);
+const cache = sim.cache.stats();
+process.stderr.write(`cache: ${cache.misses}/${cache.accesses}\n`);
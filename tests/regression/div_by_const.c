@@ -0,0 +1,24 @@
+// Division and modulo by constants, lowered to mulh and shift sequences,
+// on the ends of the int range and values around zero.
+// Expected output: -306783380 214748372 -134217728 -10050944
+// Expected output: -142861 100003 -62503 -4723
+// Expected output: -1 7 -7 -7
+// Expected output: 1 -7 7 7
+// Expected output: 142861 -100003 62503 4723
+// Expected output: 306783379 -214748371 134217742 10050943
+int main() {
+  int n[6] = {-2147483647 - 1, -1000003, -7, 7, 1000003, 2147483647};
+  int i = 0;
+  while (i < 6) {
+    putint(n[i] / 7 + n[i] % 7);
+    putch(32);
+    putint(n[i] / -10 - n[i] % -10);
+    putch(32);
+    putint(n[i] / 16 + n[i] % -16);
+    putch(32);
+    putint(n[i] / 641 * 3 + n[i] % 641);
+    putch(10);
+    i = i + 1;
+  }
+  return 0;
+}
@@ -0,0 +1,24 @@
+// n * 37 is loop invariant but read through a load that stays in the
+// loop, and only needed on one branch; n * 5 is only needed when s is
+// large. Both computations sink into the branch that uses them.
+// Expected output: 15 1560
+int main() {
+  int n = getint() + 3;
+  int i = 0;
+  int s = 0;
+  while (i < 100) {
+    int x = n * 37 + i;
+    if (i % 10 == 0) {
+      s = s + x;
+    }
+    i = i + 1;
+  }
+  int y = n * 5;
+  if (s > 1000) {
+    putint(y);
+    putch(32);
+  }
+  putint(s);
+  putch(10);
+  return 0;
+}
@@ -0,0 +1,19 @@
+// The first loop computes nothing used afterwards but the final value of
+// its counter. It is deleted; run as written, its 10^8 iterations exceed
+// the step limit of the simulator.
+// Expected output: 100000000 5
+int main() {
+  int n = getint();
+  int i = 0;
+  int t = 0;
+  while (i < 100000000) {
+    t = t * 31 + i;
+    i = i + 1;
+  }
+  t = 5;
+  putint(i);
+  putch(32);
+  putint(t + n);
+  putch(10);
+  return 0;
+}
@@ -0,0 +1,27 @@
+// Loops that must stay: the first one's result is read on one path from
+// its exit, the second one stores to a global.
+// Expected output: 1124472979 4950
+int g;
+int main() {
+  int n = getint() + 100;
+  int i = 0;
+  int t = 1;
+  int u = 0;
+  while (i < n) {
+    t = t * 3 + i;
+    i = i + 1;
+  }
+  if (n > 50) {
+    u = t;
+  }
+  i = 0;
+  while (i < n) {
+    g = g + i;
+    i = i + 1;
+  }
+  putint(u);
+  putch(32);
+  putint(g);
+  putch(10);
+  return 0;
+}
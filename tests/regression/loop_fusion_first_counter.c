@@ -0,0 +1,27 @@
+// The second loop reads the counter of the first one after it finished.
+// Fused, it would add the counter of the current iteration instead.
+// Expected output: 12 28
+int a[10];
+int b[10];
+int main() {
+  int i = 0;
+  while (i < 10) {
+    a[i] = i;
+    i = i + 1;
+  }
+  i = 0;
+  while (i < 10) {
+    a[i] = a[i] * 2;
+    i = i + 1;
+  }
+  int j = 0;
+  while (j < 10) {
+    b[j] = a[j] + i;
+    j = j + 1;
+  }
+  putint(b[1]);
+  putch(32);
+  putint(b[9]);
+  putch(10);
+  return 0;
+}
@@ -0,0 +1,21 @@
+// The first loop reads the variable the second one counts with. Fused, the
+// second loop's start value would be stored before the first loop runs.
+// Expected output: 21
+int a[20];
+int b[20];
+int main() {
+  int i = 0;
+  int j = 9;
+  while (i < 20) {
+    a[i] = a[i] + j;
+    i = i + 1;
+  }
+  j = 0;
+  while (j < 20) {
+    b[j] = a[j] + j;
+    j = j + 1;
+  }
+  putint(b[3] + a[8]);
+  putch(10);
+  return 0;
+}
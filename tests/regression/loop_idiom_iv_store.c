@@ -0,0 +1,21 @@
+// The stored value is the induction variable itself, read in the loop
+// header. The fill loop must stay a loop, not a memset of the start value.
+// Expected output: 14757
+int a[10];
+int main() {
+  int n = 10;
+  int i = 0;
+  while (i < n) {
+    a[i] = i;
+    i = i + 1;
+  }
+  int s = 0;
+  i = 0;
+  while (i < n) {
+    s = s * 3 + a[i];
+    i = i + 1;
+  }
+  putint(s);
+  putch(10);
+  return 0;
+}
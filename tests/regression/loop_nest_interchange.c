@@ -0,0 +1,28 @@
+// A column-order sum: the inner loop walks down a column of m, a cache
+// line apart per step. Interchanged, it walks along a row.
+// Expected output: 18170880
+int m[64][64];
+int main() {
+  int i = 0;
+  while (i < 64) {
+    int j = 0;
+    while (j < 64) {
+      m[i][j] = i * 3 + j;
+      j = j + 1;
+    }
+    i = i + 1;
+  }
+  int s = 0;
+  i = 0;
+  while (i < 64) {
+    int j = 0;
+    while (j < 64) {
+      s = s + m[j][i] * (i + 1);
+      j = j + 1;
+    }
+    i = i + 1;
+  }
+  putint(s);
+  putch(10);
+  return 0;
+}
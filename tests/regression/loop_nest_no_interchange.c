@@ -0,0 +1,25 @@
+// m[j][i] reads what the iteration one step back in i and one step ahead
+// in j wrote: a (<, >) dependence. The inner loop is strided, but swapping
+// the loops would read the element before it is written.
+// Expected output: 1816573344
+int m[64][64];
+int main() {
+  int i = 1;
+  while (i < 64) {
+    int j = 0;
+    while (j < 63) {
+      m[j][i] = m[j + 1][i - 1] + j;
+      j = j + 1;
+    }
+    i = i + 1;
+  }
+  int s = 0;
+  i = 0;
+  while (i < 64) {
+    s = s * 7 + m[i][63 - i] + m[63][i];
+    i = i + 1;
+  }
+  putint(s);
+  putch(10);
+  return 0;
+}
@@ -0,0 +1,31 @@
+// Each row of a is updated with the whole of v, and the 8 KiB the inner
+// loop sweeps do not fit the 4 KiB cache. Tiled, v stays in the cache
+// from one row to the next.
+// Expected output: 560308339
+int a[32][1024];
+int v[1024];
+int main() {
+  int j = 0;
+  while (j < 1024) {
+    v[j] = j % 13 - 6;
+    j = j + 1;
+  }
+  int i = 0;
+  while (i < 32) {
+    j = 0;
+    while (j < 1024) {
+      a[i][j] = a[i][j] * 3 + v[j] + i;
+      j = j + 1;
+    }
+    i = i + 1;
+  }
+  int s = 0;
+  i = 0;
+  while (i < 32) {
+    s = s * 5 + a[i][i * 16] + a[i][1023 - i];
+    i = i + 1;
+  }
+  putint(s);
+  putch(10);
+  return 0;
+}
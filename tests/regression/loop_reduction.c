@@ -0,0 +1,38 @@
+// Sum, product, max and min of an array, each split into partial results.
+// The trip count is not a constant and not a multiple of the unroll
+// factor, so the remainder loop runs too.
+// Expected output: -41 1180052131 50 -50
+int a[103];
+int main() {
+  int n = getint() + 103;
+  int i = 0;
+  while (i < n) {
+    a[i] = (i * 37 + 11) % 101 - 50;
+    i = i + 1;
+  }
+  int s = 0;
+  int p = 1;
+  int hi = -1000;
+  int lo = 1000;
+  i = 0;
+  while (i < n) {
+    s = s + a[i];
+    p = p * (a[i] % 2 * 2 + 1);
+    if (a[i] > hi) {
+      hi = a[i];
+    }
+    if (a[i] < lo) {
+      lo = a[i];
+    }
+    i = i + 1;
+  }
+  putint(s);
+  putch(32);
+  putint(p);
+  putch(32);
+  putint(hi);
+  putch(32);
+  putint(lo);
+  putch(10);
+  return 0;
+}
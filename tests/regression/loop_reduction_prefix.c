@@ -0,0 +1,26 @@
+// The running sum is stored on every iteration, so it is not a reduction
+// the loop can split.
+// Expected output: 248 92 246
+int a[50];
+int b[50];
+int main() {
+  int i = 0;
+  while (i < 50) {
+    a[i] = i * 7 % 11;
+    i = i + 1;
+  }
+  int s = 0;
+  i = 0;
+  while (i < 50) {
+    s = s + a[i];
+    b[i] = s;
+    i = i + 1;
+  }
+  putint(s);
+  putch(32);
+  putint(b[17]);
+  putch(32);
+  putint(b[48]);
+  putch(10);
+  return 0;
+}
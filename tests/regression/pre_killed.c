@@ -0,0 +1,30 @@
+// Stores to a and b on some paths kill a * b: the value computed before
+// them may not be reused after them.
+// Expected output: 75 280
+int a;
+int b;
+int main() {
+  a = getint() + 7;
+  b = getint() + 5;
+  int c = getint();
+  int x = 0;
+  if (c == 0) {
+    x = a * b;
+    a = a + 1;
+  }
+  x = a * b + x;
+  int i = 0;
+  int s = 0;
+  while (i < 10) {
+    s = s + a * b;
+    if (i == 4) {
+      b = b - 3;
+    }
+    i = i + 1;
+  }
+  putint(x);
+  putch(32);
+  putint(s);
+  putch(10);
+  return 0;
+}
@@ -0,0 +1,20 @@
+// a * b is computed on one path to the join and again after it. The
+// computation moves onto the other edge, which is critical and is split.
+// Expected output: 35 70
+int a;
+int b;
+int main() {
+  a = getint() + 7;
+  b = getint() + 5;
+  int c = getint();
+  int x = 0;
+  if (c == 0) {
+    x = a * b;
+    putint(x);
+    putch(32);
+  }
+  x = a * b + x;
+  putint(x);
+  putch(10);
+  return 0;
+}
@@ -0,0 +1,21 @@
+// Chains with constants spread over them, a common factor and canceling
+// terms; c is close to INT_MAX, so the sums wrap around.
+// Expected output: 933 -1155000 18852 -1296
+int main() {
+  int a = getint() + 1000;
+  int b = getint() - 77;
+  int c = getint() + 2147483000;
+  int x = (a + 3) + (b + 7);
+  int y = (a * 3) * (b * 5);
+  int z = a * 12 + b * 12 - c * 12;
+  int w = (c + 900) - (a - c) + (a - 900);
+  putint(x);
+  putch(32);
+  putint(y);
+  putch(32);
+  putint(z);
+  putch(32);
+  putint(w);
+  putch(10);
+  return 0;
+}
@@ -1,5 +1,72 @@
 // === Minimal RISC-V 32 Interpreter for SysY (Subset) ===
 // Supports basic integer instructions, stack operations, and simple control flow needed for SysY
+
+// Set-associative data cache with LRU replacement. Only counts hits and
+// misses for lw/sw; memory itself is always read and written directly.
+class DataCache {
+    constructor(size = 4096, lineSize = 32, ways = 4) {
+        this.lineSize = lineSize;
+        this.ways = ways;
+        this.numSets = size / (lineSize * ways);
+        this.reset();
+    }
+
+    reset() {
+        // Per set: line tags, most recently used first
+        this.sets = Array.from({ length: this.numSets }, () => []);
+        this.accesses = 0;
+        this.misses = 0;
+    }
+
+    access(addr) {
+        const line = Math.floor(addr / this.lineSize);
+        const set = this.sets[line % this.numSets];
+        const tag = Math.floor(line / this.numSets);
+        this.accesses++;
+        const idx = set.indexOf(tag);
+        if (idx >= 0) {
+            set.splice(idx, 1);
+        } else {
+            this.misses++;
+            if (set.length >= this.ways) set.pop();
+        }
+        set.unshift(tag);
+    }
+
+    stats() {
+        return { accesses: this.accesses, misses: this.misses };
+    }
+}
+
+// Bimodal branch predictor: one 2-bit saturating counter per entry,
+// indexed by the address of the branch. Only counts mispredictions.
+class BranchPredictor {
+    constructor(entries = 512) {
+        this.entries = entries;
+        this.reset();
+    }
+
+    reset() {
+        // Start weakly not taken
+        this.counters = new Uint8Array(this.entries).fill(1);
+        this.branches = 0;
+        this.mispredicts = 0;
+    }
+
+    record(pc, taken) {
+        const idx = pc % this.entries;
+        const counter = this.counters[idx];
+        this.branches++;
+        if ((counter >= 2) !== taken) this.mispredicts++;
+        if (taken && counter < 3) this.counters[idx] = counter + 1;
+        if (!taken && counter > 0) this.counters[idx] = counter - 1;
+    }
+
+    stats() {
+        return { branches: this.branches, mispredicts: this.mispredicts };
+    }
+}
+
 class MiniRiscV {
     constructor() {
         this.REG_NAMES = [
@@ -24,6 +91,8 @@ class MiniRiscV {
         this.memory = new Uint8Array(256 * 1024 * 1024); // 256MB Ram
         this.regs[2] = this.memory.length - 0x100; // Initial SP (at end of memory)
         this.pc = 0;
+        this.cache = new DataCache();
+        this.predictor = new BranchPredictor();
         this.labels = {}; // label -> address
         this.instructions = []; // parsed instructions
         
@@ -54,7 +123,7 @@ class MiniRiscV {
                 
                 if (currentSection === '.text') {
                     this.labels[label] = iAddr;
-                } else if (currentSection === '.data') {
+                } else if (currentSection === '.data' || currentSection === '.rodata') {
                     if (this.heapPointer % 4 !== 0) this.heapPointer += (4 - (this.heapPointer % 4));
                     this.labels[label] = this.heapPointer;
                 }
@@ -65,11 +134,13 @@ class MiniRiscV {
             if (line.startsWith('.')) {
                 const parts = line.split(/\s+/);
                 const dir = parts[0];
-                if (dir === '.text' || dir === '.data') {
+                if (dir === '.text' || dir === '.data' || dir === '.rodata') {
                     currentSection = dir;
+                } else if (dir === '.section') {
+                    currentSection = parts[1];
                 } else if (dir === '.globl' || dir === '.align' || dir === '.file' || dir === '.attribute' || dir === '.type' || dir === '.size') {
                     // ignore directives often produced by clang/gcc/nanocc
-                } else if (dir === '.word' && currentSection === '.data') {
+                } else if (dir === '.word' && (currentSection === '.data' || currentSection === '.rodata')) {
                     const values = line.replace('.word', '').replace(/,/g, ' ').trim().split(/\s+/);
                     for (let v of values) {
                         if (!v) continue;
@@ -80,7 +151,7 @@ class MiniRiscV {
                         this.writeInt32(this.heapPointer, val);
                         this.heapPointer += 4;
                     }
-                } else if (dir === '.zero' && currentSection === '.data') {
+                } else if (dir === '.zero' && (currentSection === '.data' || currentSection === '.rodata')) {
                    const size = parseInt(parts[1]);
                    this.heapPointer += size;
                 }
@@ -169,6 +240,34 @@ class MiniRiscV {
                     case 'slli':
                         this.setReg(parts[1], this.getReg(parts[2]) << parseInt(parts[3]));
                         break;  
+                    case 'xori':
+                        this.setReg(parts[1], this.getReg(parts[2]) ^ parseInt(parts[3]));
+                        break;
+                    case 'sll':
+                        this.setReg(parts[1], this.getReg(parts[2]) << (this.getReg(parts[3]) & 31));
+                        break;
+                    case 'srl':
+                        this.setReg(parts[1], this.getReg(parts[2]) >>> (this.getReg(parts[3]) & 31));
+                        break;
+                    case 'sra':
+                        this.setReg(parts[1], this.getReg(parts[2]) >> (this.getReg(parts[3]) & 31));
+                        break;
+                    case 'srli':
+                        this.setReg(parts[1], this.getReg(parts[2]) >>> parseInt(parts[3]));
+                        break;
+                    case 'srai':
+                        this.setReg(parts[1], this.getReg(parts[2]) >> parseInt(parts[3]));
+                        break;
+                    // Zicond
+                    case 'czero.eqz':
+                        this.setReg(parts[1], this.getReg(parts[3]) === 0 ? 0 : this.getReg(parts[2]));
+                        break;
+                    case 'czero.nez':
+                        this.setReg(parts[1], this.getReg(parts[3]) !== 0 ? 0 : this.getReg(parts[2]));
+                        break;
+                    case 'mulh':
+                        this.setReg(parts[1], Number((BigInt(this.getReg(parts[2])) * BigInt(this.getReg(parts[3]))) >> 32n));
+                        break;
                         
                     // Memory
                     case 'lw': {
@@ -177,6 +276,7 @@ class MiniRiscV {
                         if (match) {
                             const offset = match[1] ? parseInt(match[1]) : 0;
                             const base = this.getReg(match[2]);
+                            this.cache.access(base + offset);
                             this.setReg(parts[1], this.readInt32(base + offset));
                         }
                         break;
@@ -187,6 +287,7 @@ class MiniRiscV {
                             const offset = match[1] ? parseInt(match[1]) : 0;
                             const base = this.getReg(match[2]);
                             const val = this.getReg(parts[1]);
+                            this.cache.access(base + offset);
                             this.writeInt32(base + offset, val);
                         }
                         break;
@@ -200,56 +301,72 @@ class MiniRiscV {
                         break;
                     }
                     case 'bnez': {
-                        if (this.getReg(parts[1]) !== 0) {
+                        const taken = this.getReg(parts[1]) !== 0;
+                        this.predictor.record(this.pc, taken);
+                        if (taken) {
                             const target = this.labels[parts[2]];
                             if (target !== undefined) nextPC = target;
                         }
                         break;
                     }
                     case 'beqz': {
-                        if (this.getReg(parts[1]) === 0) {
+                        const taken = this.getReg(parts[1]) === 0;
+                        this.predictor.record(this.pc, taken);
+                        if (taken) {
                             const target = this.labels[parts[2]];
                             if (target !== undefined) nextPC = target;
                         }
                         break;
                     }
                     case 'beq': {
-                        if (this.getReg(parts[1]) === this.getReg(parts[2])) {
+                        const taken = this.getReg(parts[1]) === this.getReg(parts[2]);
+                        this.predictor.record(this.pc, taken);
+                        if (taken) {
                             const target = this.labels[parts[3]];
                             if (target !== undefined) nextPC = target;
                         }
                         break;
                     }
                     case 'bne': {
-                        if (this.getReg(parts[1]) !== this.getReg(parts[2])) {
+                        const taken = this.getReg(parts[1]) !== this.getReg(parts[2]);
+                        this.predictor.record(this.pc, taken);
+                        if (taken) {
                             const target = this.labels[parts[3]];
                             if (target !== undefined) nextPC = target;
                         }
                         break;
                     }
                     case 'blt': {
-                        if (this.getReg(parts[1]) < this.getReg(parts[2])) {
+                        const taken = this.getReg(parts[1]) < this.getReg(parts[2]);
+                        this.predictor.record(this.pc, taken);
+                        if (taken) {
                             const target = this.labels[parts[3]];
                             if (target !== undefined) nextPC = target;
                         }
                         break;
                     }
                     case 'bge': {
-                        if (this.getReg(parts[1]) >= this.getReg(parts[2])) {
+                        const taken = this.getReg(parts[1]) >= this.getReg(parts[2]);
+                        this.predictor.record(this.pc, taken);
+                        if (taken) {
                             const target = this.labels[parts[3]];
                             if (target !== undefined) nextPC = target;
                         }
                         break;
                     }
                     case 'bgt': {
-                        if (this.getReg(parts[1]) > this.getReg(parts[2])) {
+                        const taken = this.getReg(parts[1]) > this.getReg(parts[2]);
+                        this.predictor.record(this.pc, taken);
+                        if (taken) {
                             const target = this.labels[parts[3]];
                             if (target !== undefined) nextPC = target;
                         }
                         break;
                     }
                     case 'ble': {
-                        if (this.getReg(parts[1]) <= this.getReg(parts[2])) {
+                        const taken = this.getReg(parts[1]) <= this.getReg(parts[2]);
+                        this.predictor.record(this.pc, taken);
+                        if (taken) {
                             const target = this.labels[parts[3]];
                             if (target !== undefined) nextPC = target;
                         }
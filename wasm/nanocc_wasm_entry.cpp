@@ -12,6 +12,7 @@
 #include "nanocc/ir/IRGenVisitor.h"
 #include "nanocc/ir/IRSerializer.h"
 #include "nanocc/ir/Module.h"
+#include "nanocc/transforms/PassPipeline.h"
 #include "nanocc/backend/CodeGen.h"
 
 // Flex API
@@ -80,6 +81,7 @@ std::string compile(std::string source_code, std::string mode) {
     try {
         nanocc::IRGenVisitor irgen(module);
         ast->Accept(irgen);
+        nanocc::runOptimizationPipeline(module);
     } catch (std::exception &e) {
         return std::string("{\"error\": \"IR Gen Error: ") + json_escape(e.what()) + "\"}";
     }
@@ -96,6 +98,7 @@ std::string compile(std::string source_code, std::string mode) {
         
         try {
             ProgramCodeGen codegen;
+            codegen.SetReadOnlyGlobals(module);
             codegen.Emit(nanocc::IRSerializer::ToProgram(module));
         } catch (std::exception &e) {
             code_output = std::string("Error during RISC-V generation: ") + e.what();